@@ -0,0 +1,113 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace wavefront {
+    /**
+    * Stand-in for a Wavefront endpoint on the loopback interface. Each accepted connection is handed to serve
+    * on a thread of its own, which must close it. Servers are meant to live until the benchmarks exit.
+    */
+    class LoopbackServer {
+    public:
+        explicit LoopbackServer(std::function<void(int)> serve) : serve(std::move(serve)) {
+            listener = socket(AF_INET, SOCK_STREAM, 0);
+            if (listener < 0)
+                fail("socket()");
+            sockaddr_in address;
+            std::memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = 0;
+            if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+                fail("bind()");
+            if (listen(listener, 64) < 0)
+                fail("listen()");
+            socklen_t length = sizeof(address);
+            if (getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length) < 0)
+                fail("getsockname()");
+            port = ntohs(address.sin_port);
+            std::thread(&LoopbackServer::acceptLoop, this).detach();
+        }
+
+        inline unsigned short getPort() const {
+            return port;
+        }
+
+        inline std::string url() const {
+            return "http://127.0.0.1:" + std::to_string(port);
+        }
+
+        // read and discard everything sent on the connection, as a proxy that keeps up would
+        static void discard(int connection) {
+            char buffer[64 * 1024];
+            while (recv(connection, buffer, sizeof(buffer), 0) > 0) {
+            }
+            close(connection);
+        }
+
+    private:
+        LoopbackServer(const LoopbackServer &);
+
+        LoopbackServer &operator=(const LoopbackServer &);
+
+        void fail(const std::string &call) {
+            std::string message = "loopback server: " + call + " failed: " + std::strerror(errno);
+            if (listener >= 0) {
+                close(listener);
+            }
+            throw std::runtime_error(message);
+        }
+
+        void acceptLoop() {
+            while (true) {
+                int connection = accept(listener, nullptr, nullptr);
+                if (connection < 0)
+                    continue;
+                std::thread(serve, connection).detach();
+            }
+        }
+
+        std::function<void(int)> serve;
+        int listener;
+        unsigned short port;
+    };
+
+    /**
+    * Owns a client shared by the benchmarks of a file and closes it at exit, once the static holding it is
+    * destroyed.
+    */
+    template<typename Client>
+    class ClientHolder {
+    public:
+        explicit ClientHolder(Client *client) : client(client) {
+        }
+
+        ~ClientHolder() {
+            client->close();
+        }
+
+        inline Client &get() {
+            return *client;
+        }
+
+    private:
+        std::unique_ptr<Client> client;
+    };
+
+    // upper bound of the thread ranges of the multi-threaded benchmarks
+    inline int maxProducers() {
+        return static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+    }
+}
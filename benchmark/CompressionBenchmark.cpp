@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <list>
+#include <string>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#include "common/GzipCompressor.h"
+
+using namespace wavefront;
+
+namespace {
+    // count metric lines that differ in value and tags, so the payload compresses like a real batch
+    std::list<std::string> lines(int64_t count) {
+        std::list<std::string> result;
+        for (int64_t i = 0; i < count; i++) {
+            result.push_back("\"checkout.payments.latency\" " + std::to_string(i * 0.37) + " " +
+                             std::to_string(1533531013 + i / 100) + " source=\"app-server-" + std::to_string(i % 64) +
+                             "\" \"cluster\"=\"us-west-2\" \"endpoint\"=\"/api/v2/orders/" + std::to_string(i % 500) +
+                             "\"\n");
+        }
+        return result;
+    }
+
+    size_t totalSize(const std::list<std::string> &batch) {
+        size_t size = 0;
+        for (auto &line : batch) {
+            size += line.size();
+        }
+        return size;
+    }
+
+    // DirectIngesterService::getCompressedString, which report() uses for a list of lines
+    std::string compressStream(const std::list<std::string> &batch, int level) {
+        boost::iostreams::filtering_ostream compressingStream;
+        std::string result;
+        compressingStream.push(boost::iostreams::gzip_compressor(boost::iostreams::gzip_params(level)));
+        compressingStream.push(boost::iostreams::back_inserter(result));
+        for (auto &line : batch) {
+            compressingStream << line;
+        }
+        boost::iostreams::flush(compressingStream);
+        boost::iostreams::close(compressingStream);
+        return result;
+    }
+
+    // Args: compression level, lines per batch
+    void BM_CompressStream(benchmark::State &state) {
+        int level = static_cast<int>(state.range(0));
+        std::list<std::string> batch = lines(state.range(1));
+        size_t compressed = 0;
+        for (auto _ : state) {
+            std::string payload = compressStream(batch, level);
+            compressed = payload.size();
+            benchmark::DoNotOptimize(payload.data());
+        }
+        size_t size = totalSize(batch);
+        state.SetItemsProcessed(state.iterations() * state.range(1));
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+        state.counters["ratio"] = static_cast<double>(size) / compressed;
+    }
+
+    // the reused compressor of a flush thread, fed line by line
+    void BM_GzipCompressor(benchmark::State &state) {
+        GzipCompressor compressor(static_cast<int>(state.range(0)));
+        std::list<std::string> batch = lines(state.range(1));
+        size_t compressed = 0;
+        for (auto _ : state) {
+            for (auto &line : batch) {
+                compressor.write(line.data(), line.size());
+            }
+            compressor.finish();
+            compressed = compressor.getOutput().size();
+            benchmark::DoNotOptimize(compressor.getOutput().data());
+            compressor.reset();
+        }
+        size_t size = totalSize(batch);
+        state.SetItemsProcessed(state.iterations() * state.range(1));
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+        state.counters["ratio"] = static_cast<double>(size) / compressed;
+    }
+
+    // the same lines written as one run, as they are when adjacent in a LineArena slab
+    void BM_GzipCompressorRun(benchmark::State &state) {
+        GzipCompressor compressor(static_cast<int>(state.range(0)));
+        std::list<std::string> batch = lines(state.range(1));
+        std::string run;
+        for (auto &line : batch) {
+            run += line;
+        }
+        for (auto _ : state) {
+            compressor.write(run.data(), run.size());
+            compressor.finish();
+            benchmark::DoNotOptimize(compressor.getOutput().data());
+            compressor.reset();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(1));
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * run.size()));
+    }
+
+    void compressionArgs(benchmark::internal::Benchmark *benchmark) {
+        benchmark->ArgNames({"level", "lines"});
+        for (int level : {1, Z_DEFAULT_COMPRESSION, 9}) {
+            for (int lines : {100, 10000}) {
+                benchmark->Args({level, lines});
+            }
+        }
+        benchmark->Unit(benchmark::kMicrosecond);
+    }
+}
+
+BENCHMARK(BM_CompressStream)->Apply(compressionArgs);
+BENCHMARK(BM_GzipCompressor)->Apply(compressionArgs);
+BENCHMARK(BM_GzipCompressorRun)->Apply(compressionArgs);
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "common/EscapeScanner.h"
+#include "common/OutputBuffer.h"
+#include "common/Serializer.h"
+
+using namespace wavefront;
+
+namespace {
+    // clean value of the given length built from realistic tag content (hosts, regions, ids, paths)
+    std::string tagValue(size_t length) {
+        static const std::string sample = "prod-us-west-2.app-server-0042.cluster.local/api/v2/users/"
+                                          "7b3bf470-9456-11e8-9eb6-529269fb1459/orders?region=us-west-2&"
+                                          "az=us-west-2b&service=checkout&version=1.14.3&build=20181015-1432";
+        std::string value;
+        while (value.size() < length) {
+            value.append(sample, 0, length - value.size());
+        }
+        return value;
+    }
+
+    void BM_EscapeScanScalar(benchmark::State &state) {
+        std::string value = tagValue(static_cast<size_t>(state.range(0)));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(EscapeScanner::findScalar(value.data(), value.size()));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void BM_EscapeScan(benchmark::State &state) {
+        std::string value = tagValue(static_cast<size_t>(state.range(0)));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(EscapeScanner::find(value.data(), value.size()));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void BM_EscapeCharacter(benchmark::State &state) {
+        std::string value = tagValue(static_cast<size_t>(state.range(0)));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(Serializer::escapeCharacter(value));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void BM_AppendEscaped(benchmark::State &state) {
+        std::string value = tagValue(static_cast<size_t>(state.range(0)));
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendEscaped(out, value);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+
+    void BM_AppendEscapedWithQuotes(benchmark::State &state) {
+        // one character in every 16 needs escaping
+        std::string value = tagValue(static_cast<size_t>(state.range(0)));
+        for (size_t i = 7; i < value.size(); i += 16) {
+            value[i] = '"';
+        }
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendEscaped(out, value);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    }
+}
+
+BENCHMARK(BM_EscapeScanScalar)->RangeMultiplier(2)->Range(8, 256);
+BENCHMARK(BM_EscapeScan)->RangeMultiplier(2)->Range(8, 256);
+BENCHMARK(BM_EscapeCharacter)->RangeMultiplier(2)->Range(8, 256);
+BENCHMARK(BM_AppendEscaped)->RangeMultiplier(2)->Range(8, 256);
+BENCHMARK(BM_AppendEscapedWithQuotes)->RangeMultiplier(2)->Range(8, 256);
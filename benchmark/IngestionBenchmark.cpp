@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <string>
+
+#include "BenchmarkSupport.h"
+#include "common/GzipCompressor.h"
+#include "direct_ingestion/DirectIngesterService.h"
+#include "direct_ingestion/WavefrontDirectIngestionClient.h"
+
+using namespace wavefront;
+
+namespace {
+    // answer every request with 202 Accepted and honour keep-alive, so the benchmarks measure the client side
+    // of a flush
+    void acceptRequests(int connection) {
+        static const char RESPONSE[] = "HTTP/1.1 202 Accepted\r\nContent-Length: 0\r\n\r\n";
+        std::string request;
+        char buffer[64 * 1024];
+        while (true) {
+            size_t headerEnd = request.find("\r\n\r\n");
+            if (headerEnd != std::string::npos) {
+                size_t bodyLength = 0;
+                size_t field = request.find("Content-Length:");
+                if (field != std::string::npos && field < headerEnd) {
+                    bodyLength = std::stoul(request.substr(field + 15));
+                }
+                size_t total = headerEnd + 4 + bodyLength;
+                if (request.size() >= total) {
+                    request.erase(0, total);
+                    if (send(connection, RESPONSE, sizeof(RESPONSE) - 1, MSG_NOSIGNAL) < 0)
+                        break;
+                    continue;
+                }
+            }
+            ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+            if (received <= 0)
+                break;
+            request.append(buffer, static_cast<size_t>(received));
+        }
+        close(connection);
+    }
+
+    LoopbackServer &server() {
+        static LoopbackServer instance(acceptRequests);
+        return instance;
+    }
+
+    // a compressed batch of range(0) points
+    std::string payload(int points) {
+        GzipCompressor compressor;
+        for (int i = 0; i < points; i++) {
+            std::string line = "\"new-york.power.usage\" " + std::to_string(i) +
+                               " 1533531013 source=\"localhost\" \"datacenter\"=\"dc1\"\n";
+            compressor.write(line.data(), line.size());
+        }
+        compressor.finish();
+        return compressor.getOutput().str();
+    }
+
+    // a started client reporting to the local server, with queues large enough to ride out a slow flush
+    WavefrontDirectIngestionClient *buildDirectClient() {
+        WavefrontDirectIngestionClient::Builder builder(server().url(), "token");
+        builder.setMaxQueueSize(2000000).setMaxQueueBytes(512 * 1024 * 1024).setFlushingInterval(1)
+                .setMaxInFlightRequests(4).setCompressionLevel(1);
+        WavefrontDirectIngestionClient *client = builder.build();
+        client->start();
+        return client;
+    }
+
+    WavefrontDirectIngestionClient &directClient() {
+        static ClientHolder<WavefrontDirectIngestionClient> holder(buildDirectClient());
+        return holder.get();
+    }
+}
+
+// Arg 0: idle timeout in seconds, where 0 opens a new connection for every report
+static void BM_ReportCompressed(benchmark::State &state) {
+    DirectIngesterService service(server().url(), "token", -1, static_cast<int>(state.range(0)));
+    std::string body = payload(static_cast<int>(state.range(1)));
+    for (auto _ : state) {
+        cpr::Response response = service.reportCompressed("wavefront", body.data(), body.size());
+        if (response.status_code != 202) {
+            state.SkipWithError("report failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+BENCHMARK(BM_ReportCompressed)->ArgNames({"reuse", "points"})
+        ->Args({0, 100})->Args({30, 100})->Args({0, 10000})->Args({30, 10000})
+        ->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// Threads serialize metrics into the same client while its flush threads compress and report them
+static void BM_DirectSendMetric(benchmark::State &state) {
+    WavefrontDirectIngestionClient &client = directClient();
+    std::map<std::string, std::string> tags = {{"cluster", "us-west-2"}, {"service", "payments"},
+                                               {"thread", std::to_string(state.thread_index())}};
+    long droppedBefore = client.getStats().pointsDropped;
+    double value = 0;
+    for (auto _ : state) {
+        client.sendMetric("checkout.payments.latency", value++, 1533531013, "app-server-0042", tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        // drops of every thread, as far as they happened before this thread finished
+        state.counters["dropped"] = static_cast<double>(client.getStats().pointsDropped - droppedBefore);
+    }
+}
+
+BENCHMARK(BM_DirectSendMetric)->ThreadRange(1, maxProducers())->UseRealTime();
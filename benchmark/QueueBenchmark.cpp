@@ -0,0 +1,159 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchmarkSupport.h"
+#include "common/BoundedQueue.h"
+#include "common/GzipCompressor.h"
+#include "direct_ingestion/LineArena.h"
+
+using namespace wavefront;
+
+namespace {
+    const size_t QUEUE_SIZE = 50000;
+    const std::string LINE = "\"new-york.power.usage\" 42422 1533531013 source=\"localhost\" \"datacenter\"=\"dc1\"\n";
+
+    // the queue and locking scheme WavefrontDirectIngestionClient used before BoundedQueue
+    class MutexQueue {
+    public:
+        bool tryPush(std::string &&value) {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (queue.size() >= QUEUE_SIZE) {
+                return false;
+            }
+            queue.push(std::move(value));
+            return true;
+        }
+
+        bool tryPop(std::string &value) {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (queue.empty()) {
+                return false;
+            }
+            value = std::move(queue.front());
+            queue.pop();
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::queue<std::string> queue;
+    };
+
+    // single consumer draining the queue for as long as the producers run, like the flush thread
+    template<typename Queue>
+    class Drainer {
+    public:
+        explicit Drainer(Queue &queue) : queue(queue), running(true), thread(&Drainer::run, this) {
+        }
+
+        ~Drainer() {
+            running.store(false);
+            thread.join();
+        }
+
+    private:
+        void run() {
+            std::string line;
+            while (running.load(std::memory_order_relaxed)) {
+                if (!queue.tryPop(line)) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        Queue &queue;
+        std::atomic<bool> running;
+        std::thread thread;
+    };
+
+    template<typename Queue>
+    void BM_Enqueue(benchmark::State &state) {
+        static Queue *queue;
+        static Drainer<Queue> *drainer;
+        if (state.thread_index() == 0) {
+            queue = new Queue();
+            drainer = new Drainer<Queue>(*queue);
+        }
+        int64_t dropped = 0;
+        for (auto _ : state) {
+            std::string line(LINE);
+            if (!queue->tryPush(std::move(line))) {
+                dropped++;
+            }
+        }
+        state.counters["dropped"] = benchmark::Counter(static_cast<double>(dropped), benchmark::Counter::kAvgThreads);
+        if (state.thread_index() == 0) {
+            delete drainer;
+            delete queue;
+        }
+    }
+
+    struct LockFreeQueue : BoundedQueue<std::string> {
+        LockFreeQueue() : BoundedQueue<std::string>(QUEUE_SIZE) {
+        }
+    };
+
+}
+
+BENCHMARK_TEMPLATE(BM_Enqueue, MutexQueue)->ThreadRange(1, maxProducers())->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Enqueue, LockFreeQueue)->ThreadRange(1, maxProducers())->UseRealTime();
+
+// Arg: lines per batch. Queue a batch of lines one at a time, then compress it as a flush thread does.
+static void BM_QueuedLinesString(benchmark::State &state) {
+    std::vector<std::string> queued;
+    GzipCompressor compressor(1);
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            queued.emplace_back(LINE);
+        }
+        for (auto &line : queued) {
+            compressor.write(line.data(), line.size());
+        }
+        queued.clear();
+        compressor.finish();
+        compressor.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_QueuedLinesString)->Arg(1000)->Arg(10000);
+
+static void BM_QueuedLinesArena(benchmark::State &state) {
+    LineArena arena;
+    std::vector<LineArena::Block> queued;
+    GzipCompressor compressor(1);
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); i++) {
+            queued.push_back(arena.copy(LINE.data(), LINE.size()));
+        }
+        // adjacent lines are compressed as one run
+        LineArena::Block run;
+        for (auto &block : queued) {
+            if (run.slab != nullptr && LineArena::adjacent(run, block)) {
+                arena.release(run);
+                run.length += block.length;
+                continue;
+            }
+            if (run.slab != nullptr) {
+                compressor.write(run.data, run.length);
+                arena.release(run);
+            }
+            run = block;
+        }
+        compressor.write(run.data, run.length);
+        arena.release(run);
+        queued.clear();
+        compressor.finish();
+        compressor.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_QueuedLinesArena)->Arg(1000)->Arg(10000);
@@ -0,0 +1,134 @@
+#include <benchmark/benchmark.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/uuid/random_generator.hpp>
+
+#include "BenchmarkSupport.h"
+#include "proxy/WavefrontProxyClient.h"
+
+using namespace wavefront;
+
+namespace {
+    // an async proxy client whose buffers are large enough that no point is dropped
+    WavefrontProxyClient *buildClient(unsigned short port) {
+        WavefrontProxyClient::Builder builder("127.0.0.1");
+        builder.setMetricsPort(port).setDistributionPort(port).setTracingPort(port)
+                .setAsyncMode(true).setMaxBufferedBytes(256 * 1024 * 1024);
+        return builder.build();
+    }
+
+    WavefrontProxyClient &client() {
+        static LoopbackServer proxy(LoopbackServer::discard);
+        static ClientHolder<WavefrontProxyClient> holder(buildClient(proxy.getPort()));
+        return holder.get();
+    }
+
+    // the tags of a typical service metric, as the caller keeps them
+    const std::vector<std::pair<std::string, std::string>> &tagStrings() {
+        static const std::vector<std::pair<std::string, std::string>> tags = {
+                {"application", "checkout"}, {"cluster", "us-west-2"}, {"service", "payments"},
+                {"shard", "primary"}, {"version", "1.14.3"}};
+        return tags;
+    }
+
+    std::map<std::string, std::string> tagMap() {
+        return std::map<std::string, std::string>(tagStrings().begin(), tagStrings().end());
+    }
+
+    // views of the caller's tag strings
+    std::vector<TagView> tagViews() {
+        std::vector<TagView> views;
+        for (auto &tag : tagStrings()) {
+            views.emplace_back(tag.first, tag.second);
+        }
+        return views;
+    }
+
+    const std::string NAME = "checkout.payments.latency";
+    const std::string SOURCE = "app-server-0042";
+}
+
+static void BM_SendMetricMap(benchmark::State &state) {
+    WavefrontProxyClient &sender = client();
+    std::map<std::string, std::string> tags = tagMap();
+    for (auto _ : state) {
+        sender.sendMetric(NAME, 42.5, 1533531013, SOURCE, tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SendMetricMap);
+
+static void BM_SendMetricView(benchmark::State &state) {
+    WavefrontProxyClient &sender = client();
+    std::vector<TagView> tags = tagViews();
+    for (auto _ : state) {
+        sender.sendMetric(boost::string_view(NAME), 42.5, 1533531013, boost::string_view(SOURCE), tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SendMetricView);
+
+static void BM_SendDistributionContainers(benchmark::State &state) {
+    WavefrontProxyClient &sender = client();
+    std::list<std::pair<double, int>> centroids = {{1.5, 12}, {2.5, 40}, {7.0, 3}, {30.0, 1}};
+    std::set<HistogramGranularity> granularities = {HistogramGranularity::MINUTE, HistogramGranularity::HOUR};
+    std::map<std::string, std::string> tags = tagMap();
+    for (auto _ : state) {
+        sender.sendDistribution(NAME, centroids, granularities, 1533531013, SOURCE, tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SendDistributionContainers);
+
+static void BM_SendDistributionView(benchmark::State &state) {
+    WavefrontProxyClient &sender = client();
+    std::pair<double, int> centroids[] = {{1.5, 12}, {2.5, 40}, {7.0, 3}, {30.0, 1}};
+    HistogramGranularity granularities[] = {HistogramGranularity::MINUTE, HistogramGranularity::HOUR};
+    std::vector<TagView> tags = tagViews();
+    for (auto _ : state) {
+        sender.sendDistribution(boost::string_view(NAME), centroids, granularities, 1533531013,
+                                boost::string_view(SOURCE), tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SendDistributionView);
+
+static void BM_SendSpanContainers(benchmark::State &state) {
+    WavefrontProxyClient &sender = client();
+    boost::uuids::random_generator generator;
+    boost::uuids::uuid traceId = generator(), spanId = generator();
+    std::list<boost::uuids::uuid> parents = {generator()};
+    std::list<boost::uuids::uuid> followsFrom;
+    std::map<std::string, std::string> tags = tagMap();
+    for (auto _ : state) {
+        sender.sendSpan(NAME, 1533531013000, 343, traceId, spanId, SOURCE, parents, followsFrom, tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SendSpanContainers);
+
+static void BM_SendSpanView(benchmark::State &state) {
+    WavefrontProxyClient &sender = client();
+    boost::uuids::random_generator generator;
+    boost::uuids::uuid traceId = generator(), spanId = generator();
+    boost::uuids::uuid parents[] = {generator()};
+    std::vector<boost::uuids::uuid> followsFrom;
+    std::vector<TagView> tags = tagViews();
+    for (auto _ : state) {
+        sender.sendSpan(boost::string_view(NAME), 1533531013000, 343, traceId, spanId, boost::string_view(SOURCE),
+                        parents, followsFrom, tags);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SendSpanView);
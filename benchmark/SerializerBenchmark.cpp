@@ -0,0 +1,190 @@
+#include <benchmark/benchmark.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/uuid/random_generator.hpp>
+
+#include "common/MetricSeries.h"
+#include "common/OutputBuffer.h"
+#include "common/Serializer.h"
+#include "common/SpanLog.h"
+#include "common/TagSet.h"
+
+using namespace wavefront;
+
+namespace {
+    const std::string NAME = "checkout.payments.latency";
+    const std::string SOURCE = "app-server-0042";
+
+    // count tags shaped like those of a service: short keys, values of host names, regions and versions
+    std::map<std::string, std::string> tags(int64_t count) {
+        static const char *values[] = {"checkout", "us-west-2", "payments", "primary", "1.14.3",
+                                       "prod-us-west-2.app-server-0042.cluster.local"};
+        std::map<std::string, std::string> result;
+        for (int64_t i = 0; i < count; i++) {
+            result["tag" + std::to_string(i)] = values[i % 6];
+        }
+        return result;
+    }
+
+    // count centroids spread over a latency range, as a t-digest flushes them
+    std::list<std::pair<double, int>> centroids(int64_t count) {
+        std::list<std::pair<double, int>> result;
+        for (int64_t i = 0; i < count; i++) {
+            result.emplace_back(0.5 + i * 1.25, static_cast<int>(1 + i % 40));
+        }
+        return result;
+    }
+
+    std::list<SpanLog> spanLogs(int64_t count) {
+        std::list<SpanLog> result;
+        for (int64_t i = 0; i < count; i++) {
+            result.emplace_back(1533531013000000L + i, std::map<std::string, std::string>{
+                    {"event", "error"}, {"error.kind", "timeout"}, {"message", "upstream \"payments\" timed out"},
+                    {"stack", "at Checkout.pay(Checkout.java:42)\n\tat Server.handle(Server.java:7)"}});
+        }
+        return result;
+    }
+
+    void BM_AppendMetric(benchmark::State &state) {
+        std::map<std::string, std::string> tagMap = tags(state.range(0));
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendMetric(out, NAME, 42.5, 1533531013, SOURCE, tagMap);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+    }
+
+    void BM_AppendMetricTagSet(benchmark::State &state) {
+        std::shared_ptr<const TagSet> tagSet = TagSet::create(tags(state.range(0)));
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendMetric(out, NAME, 42.5, 1533531013, SOURCE, *tagSet);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+    }
+
+    void BM_AppendMetricSeries(benchmark::State &state) {
+        std::shared_ptr<const MetricSeries> series = MetricSeries::create(NAME, SOURCE, tags(state.range(0)));
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendMetric(out, *series, 42.5, 1533531013);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+    }
+
+    void BM_MetricsToLineData(benchmark::State &state) {
+        std::map<std::string, std::string> tagMap = tags(state.range(0));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(Serializer::metricsToLineData(NAME, 42.5, 1533531013, SOURCE, tagMap));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Args: centroids, tags
+    void BM_AppendHistogram(benchmark::State &state) {
+        std::list<std::pair<double, int>> histogram = centroids(state.range(0));
+        std::set<HistogramGranularity> granularities = {HistogramGranularity::MINUTE, HistogramGranularity::HOUR};
+        std::map<std::string, std::string> tagMap = tags(state.range(1));
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendHistogram(out, NAME, histogram, granularities, 1533531013, SOURCE, tagMap);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+    }
+
+    void BM_HistogramToLineData(benchmark::State &state) {
+        std::list<std::pair<double, int>> histogram = centroids(state.range(0));
+        std::set<HistogramGranularity> granularities = {HistogramGranularity::MINUTE, HistogramGranularity::HOUR};
+        std::map<std::string, std::string> tagMap = tags(state.range(1));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(
+                    Serializer::histogramToLineData(NAME, histogram, granularities, 1533531013, SOURCE, tagMap));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Args: tags, parents
+    void BM_AppendSpan(benchmark::State &state) {
+        boost::uuids::random_generator generator;
+        boost::uuids::uuid traceId = generator(), spanId = generator();
+        std::list<boost::uuids::uuid> parents;
+        for (int64_t i = 0; i < state.range(1); i++) {
+            parents.push_back(generator());
+        }
+        std::list<boost::uuids::uuid> followsFrom;
+        std::map<std::string, std::string> tagMap = tags(state.range(0));
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendSpan(out, NAME, 1533531013000, 343, traceId, spanId, SOURCE, parents, followsFrom,
+                                   tagMap);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+    }
+
+    void BM_SpanToLineData(benchmark::State &state) {
+        boost::uuids::random_generator generator;
+        boost::uuids::uuid traceId = generator(), spanId = generator();
+        std::list<boost::uuids::uuid> parents;
+        for (int64_t i = 0; i < state.range(1); i++) {
+            parents.push_back(generator());
+        }
+        std::map<std::string, std::string> tagMap = tags(state.range(0));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(Serializer::spanToLineData(NAME, 1533531013000, 343, traceId, spanId, SOURCE,
+                                                                parents, {}, tagMap));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Arg: span logs of four fields each, one of them needing JSON escapes
+    void BM_AppendSpanLogs(benchmark::State &state) {
+        boost::uuids::random_generator generator;
+        boost::uuids::uuid traceId = generator(), spanId = generator();
+        std::list<SpanLog> logs = spanLogs(state.range(0));
+        OutputBuffer span;
+        Serializer::appendSpan(span, NAME, 1533531013000, 343, traceId, spanId, SOURCE,
+                               std::list<boost::uuids::uuid>(), std::list<boost::uuids::uuid>(), tags(4), true);
+        OutputBuffer out;
+        for (auto _ : state) {
+            out.clear();
+            Serializer::appendSpanLogs(out, traceId, spanId, logs, span.data(), span.size() - 1);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+    }
+}
+
+BENCHMARK(BM_AppendMetric)->ArgName("tags")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_AppendMetricTagSet)->ArgName("tags")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_AppendMetricSeries)->ArgName("tags")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_MetricsToLineData)->ArgName("tags")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_AppendHistogram)->ArgNames({"centroids", "tags"})
+        ->Args({1, 4})->Args({16, 4})->Args({128, 4})->Args({1024, 4})->Args({16, 16});
+BENCHMARK(BM_HistogramToLineData)->ArgNames({"centroids", "tags"})
+        ->Args({1, 4})->Args({16, 4})->Args({128, 4})->Args({1024, 4})->Args({16, 16});
+BENCHMARK(BM_AppendSpan)->ArgNames({"tags", "parents"})
+        ->Args({0, 1})->Args({4, 1})->Args({16, 1})->Args({64, 1})->Args({4, 8});
+BENCHMARK(BM_SpanToLineData)->ArgNames({"tags", "parents"})
+        ->Args({0, 1})->Args({4, 1})->Args({16, 1})->Args({64, 1})->Args({4, 8});
+BENCHMARK(BM_AppendSpanLogs)->ArgName("logs")->Arg(1)->Arg(8)->Arg(32);
@@ -0,0 +1,361 @@
+#include "common/DoubleFormatter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace wavefront {
+    namespace {
+        const uint64_t SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+        const uint64_t EXPONENT_MASK = 0x7FF0000000000000ULL;
+        const uint64_t HIDDEN_BIT = 0x0010000000000000ULL;
+        const int SIGNIFICAND_SIZE = 52;
+        const int EXPONENT_BIAS = 0x3FF + SIGNIFICAND_SIZE;
+        const int MIN_EXPONENT = -EXPONENT_BIAS;
+
+        const uint64_t POW10[] = {
+                1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+                1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+                100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+                1000000000000000000ULL, 10000000000000000000ULL
+        };
+
+        // normalized 64-bit approximations of 10^k for k = -348, -340, ..., 340
+        struct CachedPower {
+            uint64_t significand;
+            int exponent;
+        };
+
+        const CachedPower CACHED_POWERS[] = {
+            {0xfa8fd5a0081c0288, -1220},  // 1e-348
+            {0xbaaee17fa23ebf76, -1193},  // 1e-340
+            {0x8b16fb203055ac76, -1166},  // 1e-332
+            {0xcf42894a5dce35ea, -1140},  // 1e-324
+            {0x9a6bb0aa55653b2d, -1113},  // 1e-316
+            {0xe61acf033d1a45df, -1087},  // 1e-308
+            {0xab70fe17c79ac6ca, -1060},  // 1e-300
+            {0xff77b1fcbebcdc4f, -1034},  // 1e-292
+            {0xbe5691ef416bd60c, -1007},  // 1e-284
+            {0x8dd01fad907ffc3c, -980},  // 1e-276
+            {0xd3515c2831559a83, -954},  // 1e-268
+            {0x9d71ac8fada6c9b5, -927},  // 1e-260
+            {0xea9c227723ee8bcb, -901},  // 1e-252
+            {0xaecc49914078536d, -874},  // 1e-244
+            {0x823c12795db6ce57, -847},  // 1e-236
+            {0xc21094364dfb5637, -821},  // 1e-228
+            {0x9096ea6f3848984f, -794},  // 1e-220
+            {0xd77485cb25823ac7, -768},  // 1e-212
+            {0xa086cfcd97bf97f4, -741},  // 1e-204
+            {0xef340a98172aace5, -715},  // 1e-196
+            {0xb23867fb2a35b28e, -688},  // 1e-188
+            {0x84c8d4dfd2c63f3b, -661},  // 1e-180
+            {0xc5dd44271ad3cdba, -635},  // 1e-172
+            {0x936b9fcebb25c996, -608},  // 1e-164
+            {0xdbac6c247d62a584, -582},  // 1e-156
+            {0xa3ab66580d5fdaf6, -555},  // 1e-148
+            {0xf3e2f893dec3f126, -529},  // 1e-140
+            {0xb5b5ada8aaff80b8, -502},  // 1e-132
+            {0x87625f056c7c4a8b, -475},  // 1e-124
+            {0xc9bcff6034c13053, -449},  // 1e-116
+            {0x964e858c91ba2655, -422},  // 1e-108
+            {0xdff9772470297ebd, -396},  // 1e-100
+            {0xa6dfbd9fb8e5b88f, -369},  // 1e-92
+            {0xf8a95fcf88747d94, -343},  // 1e-84
+            {0xb94470938fa89bcf, -316},  // 1e-76
+            {0x8a08f0f8bf0f156b, -289},  // 1e-68
+            {0xcdb02555653131b6, -263},  // 1e-60
+            {0x993fe2c6d07b7fac, -236},  // 1e-52
+            {0xe45c10c42a2b3b06, -210},  // 1e-44
+            {0xaa242499697392d3, -183},  // 1e-36
+            {0xfd87b5f28300ca0e, -157},  // 1e-28
+            {0xbce5086492111aeb, -130},  // 1e-20
+            {0x8cbccc096f5088cc, -103},  // 1e-12
+            {0xd1b71758e219652c, -77},  // 1e-4
+            {0x9c40000000000000, -50},  // 1e4
+            {0xe8d4a51000000000, -24},  // 1e12
+            {0xad78ebc5ac620000, 3},  // 1e20
+            {0x813f3978f8940984, 30},  // 1e28
+            {0xc097ce7bc90715b3, 56},  // 1e36
+            {0x8f7e32ce7bea5c70, 83},  // 1e44
+            {0xd5d238a4abe98068, 109},  // 1e52
+            {0x9f4f2726179a2245, 136},  // 1e60
+            {0xed63a231d4c4fb27, 162},  // 1e68
+            {0xb0de65388cc8ada8, 189},  // 1e76
+            {0x83c7088e1aab65db, 216},  // 1e84
+            {0xc45d1df942711d9a, 242},  // 1e92
+            {0x924d692ca61be758, 269},  // 1e100
+            {0xda01ee641a708dea, 295},  // 1e108
+            {0xa26da3999aef774a, 322},  // 1e116
+            {0xf209787bb47d6b85, 348},  // 1e124
+            {0xb454e4a179dd1877, 375},  // 1e132
+            {0x865b86925b9bc5c2, 402},  // 1e140
+            {0xc83553c5c8965d3d, 428},  // 1e148
+            {0x952ab45cfa97a0b3, 455},  // 1e156
+            {0xde469fbd99a05fe3, 481},  // 1e164
+            {0xa59bc234db398c25, 508},  // 1e172
+            {0xf6c69a72a3989f5c, 534},  // 1e180
+            {0xb7dcbf5354e9bece, 561},  // 1e188
+            {0x88fcf317f22241e2, 588},  // 1e196
+            {0xcc20ce9bd35c78a5, 614},  // 1e204
+            {0x98165af37b2153df, 641},  // 1e212
+            {0xe2a0b5dc971f303a, 667},  // 1e220
+            {0xa8d9d1535ce3b396, 694},  // 1e228
+            {0xfb9b7cd9a4a7443c, 720},  // 1e236
+            {0xbb764c4ca7a44410, 747},  // 1e244
+            {0x8bab8eefb6409c1a, 774},  // 1e252
+            {0xd01fef10a657842c, 800},  // 1e260
+            {0x9b10a4e5e9913129, 827},  // 1e268
+            {0xe7109bfba19c0c9d, 853},  // 1e276
+            {0xac2820d9623bf429, 880},  // 1e284
+            {0x80444b5e7aa7cf85, 907},  // 1e292
+            {0xbf21e44003acdd2d, 933},  // 1e300
+            {0x8e679c2f5e44ff8f, 960},  // 1e308
+            {0xd433179d9c8cb841, 986},  // 1e316
+            {0x9e19db92b4e31ba9, 1013},  // 1e324
+            {0xeb96bf6ebadf77d9, 1039},  // 1e332
+            {0xaf87023b9bf0ee6b, 1066},  // 1e340
+        };
+
+        // "do-it-yourself floating point": significand * 2^exponent
+        struct DiyFp {
+            DiyFp(uint64_t f, int e) : f(f), e(e) {
+            }
+
+            explicit DiyFp(double d) {
+                uint64_t bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                int biasedExponent = static_cast<int>((bits & EXPONENT_MASK) >> SIGNIFICAND_SIZE);
+                uint64_t significand = bits & SIGNIFICAND_MASK;
+                if (biasedExponent != 0) {
+                    f = significand + HIDDEN_BIT;
+                    e = biasedExponent - EXPONENT_BIAS;
+                } else {
+                    f = significand;
+                    e = MIN_EXPONENT + 1;
+                }
+            }
+
+            DiyFp operator-(const DiyFp &rhs) const {
+                return DiyFp(f - rhs.f, e);
+            }
+
+            // product rounded to the upper 64 bits
+            DiyFp operator*(const DiyFp &rhs) const {
+#if defined(__SIZEOF_INT128__)
+                unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+                uint64_t h = static_cast<uint64_t>(p >> 64);
+                uint64_t l = static_cast<uint64_t>(p);
+                if (l & (1ULL << 63)) {
+                    h++;
+                }
+                return DiyFp(h, e + rhs.e + 64);
+#else
+                const uint64_t M32 = 0xFFFFFFFFULL;
+                const uint64_t a = f >> 32;
+                const uint64_t b = f & M32;
+                const uint64_t c = rhs.f >> 32;
+                const uint64_t d = rhs.f & M32;
+                const uint64_t ac = a * c;
+                const uint64_t bc = b * c;
+                const uint64_t ad = a * d;
+                const uint64_t bd = b * d;
+                uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+                tmp += 1ULL << 31;
+                return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+#endif
+            }
+
+            DiyFp normalize() const {
+                DiyFp res = *this;
+                while (!(res.f & (1ULL << 63))) {
+                    res.f <<= 1;
+                    res.e--;
+                }
+                return res;
+            }
+
+            DiyFp normalizeBoundary() const {
+                DiyFp res = *this;
+                while (!(res.f & (HIDDEN_BIT << 1))) {
+                    res.f <<= 1;
+                    res.e--;
+                }
+                res.f <<= (64 - SIGNIFICAND_SIZE - 2);
+                res.e = res.e - (64 - SIGNIFICAND_SIZE - 2);
+                return res;
+            }
+
+            // the boundaries m- and m+ halfway to the neighbouring doubles, sharing the exponent of m+
+            void normalizedBoundaries(DiyFp *minus, DiyFp *plus) const {
+                DiyFp pl = DiyFp((f << 1) + 1, e - 1).normalizeBoundary();
+                DiyFp mi = (f == HIDDEN_BIT) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+                mi.f <<= mi.e - pl.e;
+                mi.e = pl.e;
+                *plus = pl;
+                *minus = mi;
+            }
+
+            uint64_t f;
+            int e;
+        };
+
+        DiyFp getCachedPower(int e, int *k) {
+            // pick 10^-k so that the product lands in the exponent range [-60, -32]
+            double dk = (-61 - e) * 0.30102999566398114 + 347;
+            int ik = static_cast<int>(dk);
+            if (dk - ik > 0.0) {
+                ik++;
+            }
+            unsigned index = static_cast<unsigned>((ik >> 3) + 1);
+            *k = -(-348 + static_cast<int>(index << 3));
+            return DiyFp(CACHED_POWERS[index].significand, CACHED_POWERS[index].exponent);
+        }
+
+        void grisuRound(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa,
+                        uint64_t distance) {
+            while (rest < distance && delta - rest >= tenKappa &&
+                   (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+                buffer[length - 1]--;
+                rest += tenKappa;
+            }
+        }
+
+        int countDecimalDigits(uint32_t n) {
+            int digits = 1;
+            while (digits < 10 && n >= POW10[digits]) {
+                digits++;
+            }
+            return digits;
+        }
+
+        void digitGen(const DiyFp &w, const DiyFp &mp, uint64_t delta, char *buffer, int *length, int *k) {
+            const DiyFp one(1ULL << -mp.e, mp.e);
+            const DiyFp distance = mp - w;
+            uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e);
+            uint64_t p2 = mp.f & (one.f - 1);
+            int kappa = countDecimalDigits(p1);
+            *length = 0;
+
+            while (kappa > 0) {
+                uint32_t divisor = static_cast<uint32_t>(POW10[kappa - 1]);
+                uint32_t d = p1 / divisor;
+                p1 %= divisor;
+                if (d || *length) {
+                    buffer[(*length)++] = static_cast<char>('0' + d);
+                }
+                kappa--;
+                uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+                if (rest <= delta) {
+                    *k += kappa;
+                    grisuRound(buffer, *length, delta, rest, POW10[kappa] << -one.e, distance.f);
+                    return;
+                }
+            }
+
+            for (;;) {
+                p2 *= 10;
+                delta *= 10;
+                char d = static_cast<char>(p2 >> -one.e);
+                if (d || *length) {
+                    buffer[(*length)++] = static_cast<char>('0' + d);
+                }
+                p2 &= one.f - 1;
+                kappa--;
+                if (p2 < delta) {
+                    *k += kappa;
+                    int index = -kappa;
+                    grisuRound(buffer, *length, delta, p2, one.f, distance.f * (index < 20 ? POW10[index] : 0));
+                    return;
+                }
+            }
+        }
+
+        // produce the shortest digits of a positive value such that value ~= digits * 10^k
+        void grisu2(double value, char *buffer, int *length, int *k) {
+            const DiyFp v(value);
+            DiyFp minus(0, 0), plus(0, 0);
+            v.normalizedBoundaries(&minus, &plus);
+
+            const DiyFp cachedPower = getCachedPower(plus.e, k);
+            const DiyFp w = v.normalize() * cachedPower;
+            DiyFp upper = plus * cachedPower;
+            DiyFp lower = minus * cachedPower;
+            lower.f++;
+            upper.f--;
+            digitGen(w, upper, upper.f - lower.f, buffer, length, k);
+        }
+
+        char *writeExponent(int k, char *buffer) {
+            if (k < 0) {
+                *buffer++ = '-';
+                k = -k;
+            }
+            if (k >= 100) {
+                *buffer++ = static_cast<char>('0' + k / 100);
+                k %= 100;
+                *buffer++ = static_cast<char>('0' + k / 10);
+                *buffer++ = static_cast<char>('0' + k % 10);
+            } else if (k >= 10) {
+                *buffer++ = static_cast<char>('0' + k / 10);
+                *buffer++ = static_cast<char>('0' + k % 10);
+            } else {
+                *buffer++ = static_cast<char>('0' + k);
+            }
+            return buffer;
+        }
+
+        // lay out digits * 10^k in plain or exponent notation, returning the end of the output
+        char *prettify(char *buffer, int length, int k) {
+            const int kk = length + k;  // 10^(kk-1) <= v < 10^kk
+
+            if (0 <= k && kk <= 21) {
+                // 1234e7 -> 12340000000
+                for (int i = length; i < kk; i++) {
+                    buffer[i] = '0';
+                }
+                return &buffer[kk];
+            } else if (0 < kk && kk <= 21) {
+                // 1234e-2 -> 12.34
+                std::memmove(&buffer[kk + 1], &buffer[kk], static_cast<size_t>(length - kk));
+                buffer[kk] = '.';
+                return &buffer[length + 1];
+            } else if (-6 < kk && kk <= 0) {
+                // 1234e-6 -> 0.001234
+                const int offset = 2 - kk;
+                std::memmove(&buffer[offset], &buffer[0], static_cast<size_t>(length));
+                buffer[0] = '0';
+                buffer[1] = '.';
+                for (int i = 2; i < offset; i++) {
+                    buffer[i] = '0';
+                }
+                return &buffer[length + offset];
+            } else if (length == 1) {
+                // 1e30
+                buffer[1] = 'e';
+                return writeExponent(kk - 1, &buffer[2]);
+            } else {
+                // 1234e30 -> 1.234e33
+                std::memmove(&buffer[2], &buffer[1], static_cast<size_t>(length - 1));
+                buffer[1] = '.';
+                buffer[length + 1] = 'e';
+                return writeExponent(kk - 1, &buffer[length + 2]);
+            }
+        }
+    }
+
+    size_t DoubleFormatter::format(double value, char *buffer) {
+        char *p = buffer;
+        if (std::signbit(value)) {
+            *p++ = '-';
+            value = -value;
+        }
+        if (value == 0) {
+            *p++ = '0';
+            return static_cast<size_t>(p - buffer);
+        }
+        int length = 0;
+        int k = 0;
+        grisu2(value, p, &length, &k);
+        return static_cast<size_t>(prettify(p, length, k) - buffer);
+    }
+}
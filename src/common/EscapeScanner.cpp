@@ -0,0 +1,104 @@
+#include "common/EscapeScanner.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define WAVEFRONT_ESCAPE_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+namespace wavefront {
+    namespace {
+        typedef size_t (*FindFunction)(const char *, size_t);
+
+        inline bool needsEscape(char c) {
+            return c == '\\' || c == '"' || c == '\n';
+        }
+
+        inline size_t findTail(const char *data, size_t i, size_t length) {
+            for (; i < length; ++i) {
+                if (needsEscape(data[i])) {
+                    return i;
+                }
+            }
+            return length;
+        }
+
+#ifdef WAVEFRONT_ESCAPE_SCANNER_X86
+        __attribute__((target("sse2")))
+        size_t findSse2(const char *data, size_t length) {
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i newline = _mm_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, backslash),
+                                                            _mm_cmpeq_epi8(chunk, quote)),
+                                               _mm_cmpeq_epi8(chunk, newline));
+                int mask = _mm_movemask_epi8(matches);
+                if (mask != 0) {
+                    return i + __builtin_ctz(static_cast<unsigned>(mask));
+                }
+            }
+            return findTail(data, i, length);
+        }
+
+        __attribute__((target("avx2")))
+        size_t findAvx2(const char *data, size_t length) {
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i newline = _mm256_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 32 <= length; i += 32) {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                __m256i matches = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, backslash),
+                                                                  _mm256_cmpeq_epi8(chunk, quote)),
+                                                  _mm256_cmpeq_epi8(chunk, newline));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(matches));
+                if (mask != 0) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+            // most tag keys and values are shorter than 32 bytes, finish them 16 at a time. This stays inside
+            // the AVX2 function so the 128-bit compares are VEX encoded and avoid AVX/SSE transition stalls.
+            if (i + 16 <= length) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(backslash)),
+                                                            _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(quote))),
+                                               _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(newline)));
+                int mask = _mm_movemask_epi8(matches);
+                if (mask != 0) {
+                    return i + __builtin_ctz(static_cast<unsigned>(mask));
+                }
+                i += 16;
+            }
+            return findTail(data, i, length);
+        }
+#endif
+
+        FindFunction selectImplementation() {
+#ifdef WAVEFRONT_ESCAPE_SCANNER_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return &findAvx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return &findSse2;
+            }
+#endif
+            return &EscapeScanner::findScalar;
+        }
+    }
+
+    size_t EscapeScanner::find(const char *data, size_t length) {
+        // too short for a vector compare to pay off
+        if (length < 16) {
+            return findTail(data, 0, length);
+        }
+        static const FindFunction implementation = selectImplementation();
+        return implementation(data, length);
+    }
+
+    size_t EscapeScanner::findScalar(const char *data, size_t length) {
+        return findTail(data, 0, length);
+    }
+}
@@ -0,0 +1,77 @@
+#include "common/GzipCompressor.h"
+
+#include <new>
+#include <stdexcept>
+
+namespace wavefront {
+    // 15 bits of window plus 16 selects the gzip wrapper instead of zlib
+    const static int GZIP_WINDOW_BITS = 15 + 16;
+    const static int MEMORY_LEVEL = 8;
+    // room made in the output buffer for each deflate call
+    const static size_t OUTPUT_STEP = 16 * 1024;
+
+    GzipCompressor::GzipCompressor(int level) : output(OUTPUT_STEP) {
+        if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) {
+            throw std::invalid_argument("compression level must be between -1 and 9");
+        }
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        int result = deflateInit2(&stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, MEMORY_LEVEL, Z_DEFAULT_STRATEGY);
+        if (result == Z_MEM_ERROR) {
+            throw std::bad_alloc();
+        }
+        if (result != Z_OK) {
+            throw std::invalid_argument("can't initialize gzip stream");
+        }
+    }
+
+    GzipCompressor::~GzipCompressor() {
+        deflateEnd(&stream);
+    }
+
+    void GzipCompressor::write(const char *data, size_t length) {
+        if (finished) {
+            throw std::logic_error("write to a finished gzip stream");
+        }
+        // avail_in is 32 bits wide
+        while (length > 0) {
+            uInt part = length > 0x40000000 ? 0x40000000 : static_cast<uInt>(length);
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+            stream.avail_in = part;
+            deflateInto(Z_NO_FLUSH);
+            bytesIn += part;
+            data += part;
+            length -= part;
+        }
+    }
+
+    void GzipCompressor::finish() {
+        if (finished)
+            return;
+        stream.next_in = Z_NULL;
+        stream.avail_in = 0;
+        deflateInto(Z_FINISH);
+        finished = true;
+    }
+
+    void GzipCompressor::reset() {
+        deflateReset(&stream);
+        output.clear();
+        bytesIn = 0;
+        finished = false;
+    }
+
+    void GzipCompressor::deflateInto(int flush) {
+        int result;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output.prepare(OUTPUT_STEP));
+            stream.avail_out = OUTPUT_STEP;
+            result = deflate(&stream, flush);
+            output.commit(OUTPUT_STEP - stream.avail_out);
+            if (result == Z_STREAM_ERROR) {
+                throw std::logic_error("gzip stream is in an inconsistent state");
+            }
+        } while (stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    }
+}
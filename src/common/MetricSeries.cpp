@@ -0,0 +1,31 @@
+#include "common/MetricSeries.h"
+#include "common/Serializer.h"
+
+namespace wavefront {
+    MetricSeries::MetricSeries(const std::string &name, const std::string &source,
+                               std::shared_ptr<const TagSet> tags, std::string prefix, std::string suffix)
+            : name(name), source(source), tags(std::move(tags)), prefix(std::move(prefix)),
+              suffix(std::move(suffix)) {
+    }
+
+    std::shared_ptr<const MetricSeries>
+    MetricSeries::create(const std::string &name, const std::string &source,
+                         const std::map<std::string, std::string> &tags) {
+        if (name.empty()) {
+            throw std::invalid_argument("metrics name can't be empty");
+        }
+        std::shared_ptr<const TagSet> tagSet = TagSet::intern(tags);
+        OutputBuffer prefix;
+        Serializer::appendQuoted(prefix, name);
+        prefix.push_back(' ');
+
+        OutputBuffer suffix;
+        suffix.append("source=", 7);
+        Serializer::appendQuoted(suffix, source);
+        suffix.append(tagSet->getSerialized());
+        suffix.push_back('\n');
+
+        return std::shared_ptr<const MetricSeries>(new MetricSeries(name, source, std::move(tagSet), prefix.str(),
+                                                                    suffix.str()));
+    }
+}
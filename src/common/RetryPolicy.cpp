@@ -0,0 +1,35 @@
+#include "common/RetryPolicy.h"
+
+#include <algorithm>
+#include <random>
+
+namespace wavefront {
+    RetryPolicy::RetryPolicy(const RetryOptions &options)
+            : options(options), retries(0), givenUp(0), rejected(0) {
+        this->options.initialBackoffMillis = std::max(1, options.initialBackoffMillis);
+        this->options.maxBackoffMillis = std::max(this->options.initialBackoffMillis, options.maxBackoffMillis);
+        this->options.jitter = std::min(1.0, std::max(0.0, options.jitter));
+    }
+
+    RetryPolicy::Outcome RetryPolicy::classify(int statusCode) {
+        if (statusCode >= 200 && statusCode < 300)
+            return Outcome::SUCCESS;
+        // 0: connection failure or timeout, 408: request timeout, 429: too many requests
+        if (statusCode == 0 || statusCode == 408 || statusCode == 429 || statusCode >= 500)
+            return Outcome::RETRY;
+        return Outcome::REJECT;
+    }
+
+    std::chrono::milliseconds RetryPolicy::backoff(int attempt) {
+        retries.fetch_add(1);
+        double delay = options.initialBackoffMillis;
+        for (int i = 1; i < attempt && delay < options.maxBackoffMillis; i++) {
+            delay *= 2;
+        }
+        delay = std::min(delay, static_cast<double>(options.maxBackoffMillis));
+
+        static thread_local std::minstd_rand generator(std::random_device{}());
+        std::uniform_real_distribution<double> spread(1.0 - options.jitter, 1.0);
+        return std::chrono::milliseconds(static_cast<long>(delay * spread(generator)));
+    }
+}
@@ -4,10 +4,26 @@
 #include <arpa/inet.h>       // For inet_addr()
 #include <unistd.h>          // For close()
 #include <netinet/in.h>      // For sockaddr_in
+#include <netinet/tcp.h>     // For TCP_NODELAY and TCP_CORK
 #include <arpa/inet.h>       // For inet_addr()
+#include <fcntl.h>           // For fcntl()
+#include <algorithm>         // For std::min
+#include <climits>           // For IOV_MAX
+#include <errno.h>           // For errno
 #include <iostream>
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 namespace wavefront {
+#ifdef MSG_NOSIGNAL
+    // report a closed peer as EPIPE instead of raising SIGPIPE
+    static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    static const int SEND_FLAGS = 0;
+#endif
+
     // Function to fill in address structure given an address and port
     static void fillAddr(const std::string &address, unsigned short port,
                          sockaddr_in &addr) {
@@ -125,9 +141,116 @@ namespace wavefront {
 
     void CommunicatingSocket::send(const char *buffer, int bufferLen)
     throw(SocketException) {
-        if (::send(sockDesc, (void *) buffer, bufferLen, 0) < 0) {
-            throw SocketException("Send failed (send())", true);
+        iovec single;
+        single.iov_base = const_cast<char *>(buffer);
+        single.iov_len = static_cast<size_t>(bufferLen);
+        sendv(&single, 1);
+    }
+
+    void CommunicatingSocket::sendv(iovec *buffers, int count)
+    throw(SocketException) {
+        writeBuffers(buffers, count, false);
+    }
+
+    int CommunicatingSocket::trySendv(iovec *buffers, int count)
+    throw(SocketException) {
+        return writeBuffers(buffers, count, true);
+    }
+
+    int CommunicatingSocket::writeBuffers(iovec *buffers, int count, bool nonBlocking)
+    throw(SocketException) {
+        int index = 0;
+        while (index < count) {
+            msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = buffers + index;
+            message.msg_iovlen = std::min(count - index, IOV_MAX);
+
+            ssize_t written = ::sendmsg(sockDesc, &message, SEND_FLAGS);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (nonBlocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    return index;
+                }
+                throw SocketException("Send failed (sendmsg())", true);
+            }
+            // skip the buffers written completely and advance into a partially written one
+            size_t remaining = static_cast<size_t>(written);
+            while (index < count && remaining >= buffers[index].iov_len) {
+                remaining -= buffers[index].iov_len;
+                index++;
+            }
+            if (remaining > 0) {
+                buffers[index].iov_base = static_cast<char *>(buffers[index].iov_base) + remaining;
+                buffers[index].iov_len -= remaining;
+            }
         }
+        return index;
     }
-}
 
+    void CommunicatingSocket::setNonBlocking(bool nonBlocking) throw(SocketException) {
+        int flags = fcntl(sockDesc, F_GETFL, 0);
+        if (flags < 0) {
+            throw SocketException("Fetch of socket flags failed (fcntl())", true);
+        }
+        flags = nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+        if (fcntl(sockDesc, F_SETFL, flags) < 0) {
+            throw SocketException("Set of socket flags failed (fcntl())", true);
+        }
+    }
+
+    bool CommunicatingSocket::connectNonBlocking(const std::string &foreignAddress,
+                                                 unsigned short foreignPort) throw(SocketException) {
+        sockaddr_in destAddr;
+        fillAddr(foreignAddress, foreignPort, destAddr);
+
+        if (::connect(sockDesc, (sockaddr *) &destAddr, sizeof(destAddr)) < 0) {
+            // an interrupted connect carries on in the background, like one in progress
+            if (errno == EINPROGRESS || errno == EINTR) {
+                return false;
+            }
+            throw SocketException("Connect failed (connect())", true);
+        }
+        return true;
+    }
+
+    void CommunicatingSocket::finishConnect() throw(SocketException) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(sockDesc, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+            throw SocketException("Fetch of connect status failed (getsockopt())", true);
+        }
+        if (error != 0) {
+            errno = error;
+            throw SocketException("Connect failed (connect())", true);
+        }
+    }
+
+    void CommunicatingSocket::applyOptions(const SocketOptions &options) throw(SocketException) {
+        if (options.tcpNoDelay) {
+            int enabled = 1;
+            if (setsockopt(sockDesc, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled)) < 0) {
+                throw SocketException("Set of TCP_NODELAY failed (setsockopt())", true);
+            }
+        }
+        if (options.sendBufferSize > 0) {
+            int size = options.sendBufferSize;
+            if (setsockopt(sockDesc, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0) {
+                throw SocketException("Set of SO_SNDBUF failed (setsockopt())", true);
+            }
+        }
+    }
+
+    void CommunicatingSocket::setCork(bool cork) throw(SocketException) {
+#ifdef TCP_CORK
+        int enabled = cork ? 1 : 0;
+        if (setsockopt(sockDesc, IPPROTO_TCP, TCP_CORK, &enabled, sizeof(enabled)) < 0) {
+            throw SocketException("Set of TCP_CORK failed (setsockopt())", true);
+        }
+#else
+        (void) cork;
+#endif
+    }
+}
@@ -0,0 +1,59 @@
+#include "common/TagSet.h"
+#include "common/Serializer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace wavefront {
+    namespace {
+        // serialized tags -> live TagSet; entries whose TagSet is gone are replaced on the next lookup
+        std::mutex internMutex;
+        std::unordered_map<std::string, std::weak_ptr<const TagSet>> internTable;
+
+        const size_t PURGE_THRESHOLD = 1024;
+        size_t purgeAt = PURGE_THRESHOLD;
+
+        void purgeExpired() {
+            for (auto it = internTable.begin(); it != internTable.end();) {
+                if (it->second.expired()) {
+                    it = internTable.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            purgeAt = std::max(PURGE_THRESHOLD, internTable.size() * 2);
+        }
+    }
+
+    TagSet::TagSet(const TagMap &tags, std::string serialized, Token) : tags(tags),
+                                                                        serialized(std::move(serialized)) {
+    }
+
+    std::string TagSet::serialize(const TagMap &tags) {
+        OutputBuffer out;
+        Serializer::appendTagMap(out, tags);
+        return out.str();
+    }
+
+    std::shared_ptr<const TagSet> TagSet::create(const TagMap &tags) {
+        return std::shared_ptr<const TagSet>(new TagSet(tags, serialize(tags), Token()));
+    }
+
+    std::shared_ptr<const TagSet> TagSet::intern(const TagMap &tags) {
+        std::string key = serialize(tags);
+
+        std::lock_guard<std::mutex> lock{internMutex};
+        std::weak_ptr<const TagSet> &entry = internTable[key];
+        std::shared_ptr<const TagSet> existing = entry.lock();
+        if (existing != nullptr) {
+            return existing;
+        }
+        std::shared_ptr<const TagSet> created(new TagSet(tags, key, Token()));
+        entry = created;
+        if (internTable.size() >= purgeAt) {
+            purgeExpired();
+        }
+        return created;
+    }
+}
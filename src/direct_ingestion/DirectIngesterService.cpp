@@ -7,32 +7,74 @@ namespace wavefront {
     const static std::string CONTENT_TYPE = "application/octet-stream";
     // connection timeout, in ms
     const static int32_t TIMEOUT = 5000;
+    // idle sessions kept for reuse, enough for the in-flight reports of every lane at the default settings
+    const static size_t MAX_IDLE_SESSIONS = 8;
 
-    DirectIngesterService::DirectIngesterService(std::string uri, std::string token) : uri(uri), token(token) {
+    DirectIngesterService::DirectIngesterService(std::string uri, std::string token, int compressionLevel,
+                                                 int idleTimeoutSeconds)
+            : uri(uri), token(token), compressionLevel(compressionLevel), idleTimeoutSeconds(idleTimeoutSeconds) {
 
     }
 
     cpr::Response DirectIngesterService::report(std::string format, std::list<std::string> targets) {
-        cpr::Session session;
+        return post(format, cpr::Body{getCompressedString(targets)});
+    }
+
+    cpr::Response DirectIngesterService::reportCompressed(const std::string &format, const char *payload,
+                                                          size_t length) {
+        return post(format, cpr::Body{payload, length});
+    }
+
+    cpr::Response DirectIngesterService::post(const std::string &format, cpr::Body &&body) {
+        std::unique_ptr<PooledSession> pooled = acquireSession();
         // construct url
-        std::string url = uri + "/report?f=" + format;
-        session.SetUrl(cpr::Url{url});
-        session.SetHeader(cpr::Header{{"Content-Type",     CONTENT_TYPE},
-                                      {"Content-Encoding", "gzip"},
-                                      {"Authorization",    "Bearer " + token},
-                                      {"Connection",       "keep-alive"}});
-        session.SetTimeout(cpr::Timeout{TIMEOUT});
-        session.SetBody(cpr::Body{getCompressedString(targets)});
-
-        auto response = session.Post();
+        pooled->session.SetUrl(cpr::Url{uri + "/report?f=" + format});
+        pooled->session.SetBody(std::move(body));
+
+        auto response = pooled->session.Post();
+        // a transport error may leave the connection unusable, the next report opens a new one
+        if (!response.error) {
+            releaseSession(std::move(pooled));
+        }
         return response;
     }
 
+    std::unique_ptr<DirectIngesterService::PooledSession> DirectIngesterService::acquireSession() {
+        {
+            std::lock_guard<std::mutex> lock{sessionMutex};
+            auto now = std::chrono::steady_clock::now();
+            while (!idleSessions.empty()) {
+                std::unique_ptr<PooledSession> pooled = std::move(idleSessions.back());
+                idleSessions.pop_back();
+                if (now - pooled->lastUsed < std::chrono::seconds(idleTimeoutSeconds)) {
+                    return pooled;
+                }
+            }
+        }
+        std::unique_ptr<PooledSession> pooled(new PooledSession());
+        pooled->session.SetHeader(cpr::Header{{"Content-Type",     CONTENT_TYPE},
+                                              {"Content-Encoding", "gzip"},
+                                              {"Authorization",    "Bearer " + token},
+                                              {"Connection",       "keep-alive"}});
+        pooled->session.SetTimeout(cpr::Timeout{TIMEOUT});
+        return pooled;
+    }
+
+    void DirectIngesterService::releaseSession(std::unique_ptr<PooledSession> session) {
+        if (idleTimeoutSeconds <= 0)
+            return;
+        session->lastUsed = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock{sessionMutex};
+        if (idleSessions.size() < MAX_IDLE_SESSIONS) {
+            idleSessions.push_back(std::move(session));
+        }
+    }
+
     std::string DirectIngesterService::getCompressedString(const std::list<std::string> &targets) {
         boost::iostreams::filtering_ostream compressingStream;
         std::string result = "";
 
-        compressingStream.push(boost::iostreams::gzip_compressor());
+        compressingStream.push(boost::iostreams::gzip_compressor(boost::iostreams::gzip_params(compressionLevel)));
         compressingStream.push(boost::iostreams::back_inserter(result));
 
         for (auto &stringToBeCompressed : targets)
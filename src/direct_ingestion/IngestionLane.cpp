@@ -0,0 +1,447 @@
+#include "direct_ingestion/IngestionLane.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+
+namespace wavefront {
+    // streaming mode: compress a batch in this many slices as it fills up
+    const static int STREAMING_SLICES = 8;
+
+    IngestionLane::IngestionLane(const std::string &name, const std::string &format, const LaneOptions &options,
+                                 DirectIngesterService &service, RetryPolicy &retryPolicy, SdkMetrics &metrics,
+                                 bool streamingCompression, int compressionLevel, std::unique_ptr<SpillQueue> spill)
+            : name(name), format(format), batchSize(options.batchSize), batchBytes(options.batchBytes),
+              flushIntervalSeconds(options.flushIntervalSeconds), streamingCompression(streamingCompression),
+              compressionLevel(compressionLevel),
+              wakeThreshold(std::max(1, streamingCompression ? options.batchSize / STREAMING_SLICES
+                                                             : options.batchSize)),
+              wakeBytes(std::max(static_cast<size_t>(1), streamingCompression ? options.batchBytes / STREAMING_SLICES
+                                                                              : options.batchBytes)),
+              queue(options.maxQueueSize), queuedPoints(0), maxQueuedPoints(options.maxQueueSize), queuedBytes(0),
+              maxQueuedBytes(options.maxQueueBytes), service(service), retryPolicy(retryPolicy),
+              metrics(metrics), workers(options.maxInFlight),
+              failures(0),
+              wakeRequested(false), is_running(false), stopping(false), spill(std::move(spill)) {
+        for (Worker &worker : workers) {
+            worker.batch.reset(new CompressedBatch(compressionLevel));
+        }
+    }
+
+    IngestionLane::~IngestionLane() {
+        if (is_running.load()) {
+            stop(std::chrono::steady_clock::now());
+            join();
+        }
+        // lines sent after close
+        QueuedLines lines;
+        while (pop(lines)) {
+            arena.release(lines.block);
+        }
+    }
+
+    bool IngestionLane::enqueue(const OutputBuffer &lineData) {
+        return enqueue(lineData, 1);
+    }
+
+    bool IngestionLane::enqueue(const OutputBuffer &lineData, int points) {
+        size_t queued = queuedPoints.fetch_add(static_cast<size_t>(points)) + points;
+        size_t bytes = queuedBytes.fetch_add(lineData.size()) + lineData.size();
+        bool accepted = false;
+        if (queued <= maxQueuedPoints && bytes <= maxQueuedBytes) {
+            QueuedLines lines;
+            lines.block = arena.copy(lineData.data(), lineData.size());
+            lines.points = points;
+            accepted = queue.tryPush(std::move(lines));
+            if (!accepted) {
+                arena.release(lines.block);
+            }
+        }
+        if (!accepted) {
+            queuedPoints.fetch_sub(static_cast<size_t>(points));
+            queuedBytes.fetch_sub(lineData.size());
+            metrics.pointsDropped.inc(points);
+            if (points == 1) {
+                std::cerr << "Buffer full, dropping " << name << ": ";
+                std::cerr.write(lineData.data(), static_cast<std::streamsize>(lineData.size())) << std::endl;
+            } else {
+                std::cerr << "Buffer full, dropping " << points << " " << name << " points" << std::endl;
+            }
+            return false;
+        }
+        metrics.pointsSent.inc(points);
+        if ((queued >= wakeThreshold || bytes >= wakeBytes) && !wakeRequested.exchange(true)) {
+            std::lock_guard<std::mutex> lock{mutex};
+            condition.notify_one();
+        }
+        return true;
+    }
+
+    bool IngestionLane::pop(QueuedLines &lines) {
+        if (!queue.tryPop(lines))
+            return false;
+        queuedPoints.fetch_sub(static_cast<size_t>(lines.points));
+        queuedBytes.fetch_sub(lines.block.length);
+        return true;
+    }
+
+    LaneGauges IngestionLane::getGauges() {
+        LaneGauges gauges;
+        gauges.queuedPoints = queuedPoints.load();
+        gauges.queuedBytes = queuedBytes.load();
+        gauges.arenaBytes = arena.getAllocatedBytes();
+        gauges.spilledBytes = spill != nullptr ? spill->getPendingBytes() : 0;
+        return gauges;
+    }
+
+    void IngestionLane::start() {
+        is_running.store(true);
+        for (Worker &worker : workers) {
+            worker.thread = std::thread(&IngestionLane::run, this, std::ref(worker));
+        }
+        if (spill != nullptr) {
+            spillDrainer = std::thread(&IngestionLane::replaySpill, this);
+        }
+    }
+
+    void IngestionLane::stop(std::chrono::steady_clock::time_point deadline) {
+        if (!is_running.load()) {
+            for (Worker &worker : workers) {
+                drain(worker, deadline);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopDeadline = deadline;
+            stopping.store(true);
+        }
+        condition.notify_all();
+        spillCondition.notify_all();
+    }
+
+    void IngestionLane::join() {
+        for (Worker &worker : workers) {
+            if (worker.thread.joinable()) {
+                worker.thread.join();
+            }
+        }
+        if (spillDrainer.joinable()) {
+            spillDrainer.join();
+        }
+        is_running.store(false);
+        if (spill != nullptr) {
+            // keep what is still queued on disk for the next run
+            std::list<QueuedLines> lines;
+            int points = 0;
+            size_t bytes = 0;
+            QueuedLines entry;
+            while (pop(entry)) {
+                points += entry.points;
+                bytes += entry.block.length;
+                lines.emplace_back(std::move(entry));
+                if (points >= batchSize || bytes >= batchBytes) {
+                    spillLines(lines);
+                    lines.clear();
+                    points = 0;
+                    bytes = 0;
+                }
+            }
+            if (!lines.empty()) {
+                spillLines(lines);
+            }
+        }
+        size_t dropped = 0;
+        QueuedLines entry;
+        while (pop(entry)) {
+            dropped += static_cast<size_t>(entry.points);
+            arena.release(entry.block);
+        }
+        if (dropped > 0) {
+            metrics.pointsDropped.inc(static_cast<long>(dropped));
+            std::cerr << "Dropping " << dropped << " " << name << " points still queued on close" << std::endl;
+        }
+    }
+
+    void IngestionLane::run(Worker &worker) {
+        auto nextFlush = std::chrono::steady_clock::now() + std::chrono::seconds(flushIntervalSeconds);
+        PendingRetry &retry = worker.retry;
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            // while a retry is pending only its backoff, the interval or shutdown wake this thread
+            auto wakeAt = retry.points > 0 ? std::min(nextFlush, retry.retryAt) : nextFlush;
+            condition.wait_until(lock, wakeAt, [this, &retry] {
+                return stopping.load() ||
+                       (retry.points == 0 && (wakeRequested.load() || queuedPoints.load() >= wakeThreshold ||
+                                              queuedBytes.load() >= wakeBytes));
+            });
+            if (stopping.load())
+                break;
+            wakeRequested.store(false);
+            bool due = std::chrono::steady_clock::now() >= nextFlush;
+            lock.unlock();
+
+            // nothing newer is reported before a pending retry succeeds or is given up
+            if (resolveRetry(worker)) {
+                // more than this thread takes; let another flush thread report concurrently
+                if (queuedPoints.load() >= 2 * wakeThreshold || queuedBytes.load() >= 2 * wakeBytes) {
+                    condition.notify_one();
+                }
+                if (streamingCompression) {
+                    compressQueued(worker);
+                    if (due) {
+                        reportBatch(worker);
+                    }
+                } else {
+                    // full batches go out right away, a partial one once per interval
+                    while (!stopping.load() && batchQueued() && reportQueued(worker)) {
+                    }
+                    if (due && retry.points == 0) {
+                        reportQueued(worker);
+                    }
+                }
+            }
+
+            lock.lock();
+            if (due) {
+                nextFlush = std::chrono::steady_clock::now() + std::chrono::seconds(flushIntervalSeconds);
+            }
+        }
+        auto deadline = stopDeadline;
+        lock.unlock();
+        drain(worker, deadline);
+    }
+
+    void IngestionLane::drain(Worker &worker, std::chrono::steady_clock::time_point deadline) {
+        auto inTime = [deadline] {
+            return std::chrono::steady_clock::now() < deadline;
+        };
+        // a pending retry gets one last attempt regardless of its backoff
+        worker.retry.retryAt = std::chrono::steady_clock::now();
+        if (inTime() && resolveRetry(worker)) {
+            if (streamingCompression) {
+                compressQueued(worker);
+                if (inTime()) {
+                    reportBatch(worker);
+                }
+            } else {
+                while (inTime() && reportQueued(worker)) {
+                }
+            }
+        }
+
+        CompressedBatch &batch = *worker.batch;
+        if (batch.points > 0) {
+            batch.compressor.finish();
+            discard(batch.compressor.getOutput(), batch.points);
+            batch.compressor.reset();
+            batch.points = 0;
+            batch.bytes = 0;
+            batch.compressionTime = std::chrono::nanoseconds(0);
+        }
+        PendingRetry &retry = worker.retry;
+        if (retry.points > 0) {
+            discard(retry.payload, retry.points);
+            retry.payload.clear();
+            retry.points = 0;
+            retry.attempts = 0;
+        }
+    }
+
+    bool IngestionLane::resolveRetry(Worker &worker) {
+        PendingRetry &retry = worker.retry;
+        if (retry.points == 0)
+            return true;
+        if (std::chrono::steady_clock::now() < retry.retryAt)
+            return false;
+
+        RetryPolicy::Outcome outcome = reportPayload(retry.payload.data(), retry.payload.size(), retry.points);
+        if (outcome == RetryPolicy::Outcome::RETRY) {
+            if (retryPolicy.canRetry(++retry.attempts)) {
+                retry.retryAt = std::chrono::steady_clock::now() + retryPolicy.backoff(retry.attempts);
+                return false;
+            }
+            retryPolicy.recordGiveUp();
+            metrics.pointsDropped.inc(retry.points);
+            std::cerr << "Dropping " << retry.points << " points of format " << format << " after "
+                      << retry.attempts << " failed attempts" << std::endl;
+        }
+        retry.payload.clear();
+        retry.points = 0;
+        retry.attempts = 0;
+        return true;
+    }
+
+    bool IngestionLane::reportQueued(Worker &worker) {
+        // drain up to one batch; producers keep appending concurrently
+        CompressedBatch &batch = *worker.batch;
+        QueuedLines lines;
+        LineArena::Block run;
+        while (!batch.full(batchSize, batchBytes) && pop(lines)) {
+            appendRun(batch, run, lines.block);
+            batch.points += lines.points;
+            batch.bytes += lines.block.length;
+        }
+        writeRun(batch, run);
+        if (batch.points == 0)
+            return false;
+        return reportBatch(worker);
+    }
+
+    void IngestionLane::compressQueued(Worker &worker) {
+        CompressedBatch &batch = *worker.batch;
+        QueuedLines lines;
+        LineArena::Block run;
+        while (worker.retry.points == 0 && pop(lines)) {
+            appendRun(batch, run, lines.block);
+            batch.points += lines.points;
+            batch.bytes += lines.block.length;
+            if (batch.full(batchSize, batchBytes)) {
+                writeRun(batch, run);
+                reportBatch(worker);
+            }
+        }
+        writeRun(batch, run);
+    }
+
+    void IngestionLane::appendRun(CompressedBatch &batch, LineArena::Block &run, const LineArena::Block &lines) {
+        if (run.slab != nullptr && LineArena::adjacent(run, lines)) {
+            // the reference of the new lines keeps the slab
+            arena.release(run);
+            run.length += lines.length;
+            return;
+        }
+        writeRun(batch, run);
+        run = lines;
+    }
+
+    void IngestionLane::writeRun(CompressedBatch &batch, LineArena::Block &run) {
+        if (run.slab == nullptr)
+            return;
+        auto start = std::chrono::steady_clock::now();
+        batch.compressor.write(run.data, run.length);
+        batch.compressionTime += std::chrono::steady_clock::now() - start;
+        arena.release(run);
+        run = LineArena::Block();
+    }
+
+    bool IngestionLane::reportBatch(Worker &worker) {
+        CompressedBatch &batch = *worker.batch;
+        PendingRetry &retry = worker.retry;
+        if (retry.points > 0)
+            return false;
+        if (batch.points == 0)
+            return true;
+
+        auto start = std::chrono::steady_clock::now();
+        batch.compressor.finish();
+        OutputBuffer &payload = batch.compressor.getOutput();
+        metrics.compression.update(batch.compressionTime + (std::chrono::steady_clock::now() - start));
+        metrics.compressedBytesIn.inc(static_cast<long>(batch.bytes));
+        metrics.compressedBytesOut.inc(static_cast<long>(payload.size()));
+        bool resolved = true;
+        // while spilled data waits for replay, new batches go behind it to keep points in order
+        if (spill != nullptr && !spill->empty()) {
+            spillPayload(payload.data(), payload.size(), batch.points);
+        } else if (reportPayload(payload.data(), payload.size(), batch.points) == RetryPolicy::Outcome::RETRY) {
+            if (spill != nullptr) {
+                spillPayload(payload.data(), payload.size(), batch.points);
+            } else {
+                // keep the compressed payload; the swap hands the old retry buffer to the compressor
+                std::swap(retry.payload, payload);
+                retry.points = batch.points;
+                retry.attempts = 1;
+                retry.retryAt = std::chrono::steady_clock::now() + retryPolicy.backoff(retry.attempts);
+                resolved = false;
+            }
+        }
+        batch.compressor.reset();
+        batch.points = 0;
+        batch.bytes = 0;
+        batch.compressionTime = std::chrono::nanoseconds(0);
+        return resolved;
+    }
+
+    RetryPolicy::Outcome IngestionLane::reportPayload(const char *payload, size_t length, int points) {
+        auto start = std::chrono::steady_clock::now();
+        cpr::Response response = service.reportCompressed(format, payload, length);
+        metrics.report.update(std::chrono::steady_clock::now() - start);
+        metrics.reports.inc();
+        RetryPolicy::Outcome outcome = RetryPolicy::classify(response.status_code);
+        if (outcome != RetryPolicy::Outcome::SUCCESS) {
+            failures.fetch_add(1);
+            metrics.reportErrors.inc();
+            std::cerr << "Error reporting points, respStatus = " + std::to_string(response.status_code) +
+                         " [" + response.error.message + "] " << std::endl;
+            if (outcome == RetryPolicy::Outcome::REJECT) {
+                retryPolicy.recordRejected();
+                metrics.pointsDropped.inc(points);
+                std::cerr << "Dropping " << points << " rejected points of format " << format << std::endl;
+            }
+            return outcome;
+        }
+        metrics.bytesSent.inc(static_cast<long>(length));
+        return outcome;
+    }
+
+    void IngestionLane::replaySpill() {
+        // spilled payloads are retried until they are reported, however many attempts that takes
+        int attempts = 0;
+        std::unique_lock<std::mutex> lock{mutex};
+        while (!stopping.load()) {
+            const char *payload;
+            size_t length;
+            int points;
+            if (!spill->peek(payload, length, points)) {
+                spillCondition.wait(lock, [this] {
+                    return stopping.load() || !spill->empty();
+                });
+                continue;
+            }
+            lock.unlock();
+            // the payload stays mapped until pop(), which only this thread calls
+            RetryPolicy::Outcome outcome = reportPayload(payload, length, points);
+            lock.lock();
+            if (outcome != RetryPolicy::Outcome::RETRY) {
+                spill->pop();
+                attempts = 0;
+            } else {
+                spillCondition.wait_for(lock, retryPolicy.backoff(++attempts), [this] {
+                    return stopping.load();
+                });
+            }
+        }
+    }
+
+    void IngestionLane::spillPayload(const char *payload, size_t length, int points) {
+        if (!spill->append(payload, length, points)) {
+            metrics.pointsDropped.inc(points);
+            std::cerr << "Spill full, dropping " << points << " points of format " << format << std::endl;
+            return;
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        spillCondition.notify_one();
+    }
+
+    void IngestionLane::spillLines(const std::list<QueuedLines> &lines) {
+        GzipCompressor compressor(compressionLevel);
+        int points = 0;
+        for (auto &entry : lines) {
+            compressor.write(entry.block.data, entry.block.length);
+            arena.release(entry.block);
+            points += entry.points;
+        }
+        compressor.finish();
+        spillPayload(compressor.getOutput().data(), compressor.getOutput().size(), points);
+    }
+
+    void IngestionLane::discard(OutputBuffer &payload, int points) {
+        if (spill != nullptr) {
+            spillPayload(payload.data(), payload.size(), points);
+        } else {
+            metrics.pointsDropped.inc(points);
+            std::cerr << "Dropping " << points << " " << name << " points not reported before close" << std::endl;
+        }
+    }
+}
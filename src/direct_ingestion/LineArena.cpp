@@ -0,0 +1,106 @@
+#include "direct_ingestion/LineArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "metrics/Striped.h"
+
+namespace wavefront {
+    // stripes beyond this many would mostly hold idle slabs
+    const static size_t MAX_ARENA_STRIPES = 8;
+
+    struct LineArena::Slab {
+        explicit Slab(size_t capacity) : bytes(new char[capacity]), capacity(capacity), used(0), references(1) {
+        }
+
+        std::unique_ptr<char[]> bytes;
+        const size_t capacity;
+        // only changed under the lock of the stripe the slab is current in
+        size_t used;
+        std::atomic<long> references;
+    };
+
+    LineArena::LineArena(size_t slabSize, size_t maxFreeSlabs)
+            : slabSize(std::max(static_cast<size_t>(1), slabSize)), maxFreeSlabs(maxFreeSlabs),
+              stripeCount(std::min(Stripes::count(), MAX_ARENA_STRIPES)), stripes(new Stripe[stripeCount]),
+              allocatedBytes(0) {
+    }
+
+    LineArena::~LineArena() {
+        for (size_t i = 0; i < stripeCount; i++) {
+            if (stripes[i].current != nullptr) {
+                unreference(stripes[i].current);
+            }
+        }
+        for (Slab *slab : freeSlabs) {
+            delete slab;
+        }
+    }
+
+    LineArena::Block LineArena::copy(const char *data, size_t length) {
+        Block block;
+        block.length = length;
+        char *target;
+        if (length > slabSize) {
+            // the block holds the only reference
+            block.slab = acquire(length);
+            block.slab->used = length;
+            target = block.slab->bytes.get();
+        } else {
+            // both stripe counts are powers of two
+            Stripe &stripe = stripes[Stripes::index() & (stripeCount - 1)];
+            std::lock_guard<std::mutex> lock{stripe.mutex};
+            Slab *slab = stripe.current;
+            if (slab == nullptr || slab->used + length > slab->capacity) {
+                if (slab != nullptr) {
+                    unreference(slab);
+                }
+                slab = acquire(slabSize);
+                stripe.current = slab;
+            }
+            slab->references.fetch_add(1, std::memory_order_relaxed);
+            block.slab = slab;
+            target = slab->bytes.get() + slab->used;
+            slab->used += length;
+        }
+        // the space is reserved and the slab referenced, so the copy needs no lock
+        std::memcpy(target, data, length);
+        block.data = target;
+        return block;
+    }
+
+    void LineArena::release(const Block &block) {
+        if (block.slab != nullptr) {
+            unreference(block.slab);
+        }
+    }
+
+    LineArena::Slab *LineArena::acquire(size_t capacity) {
+        if (capacity == slabSize) {
+            std::lock_guard<std::mutex> lock{freeMutex};
+            if (!freeSlabs.empty()) {
+                Slab *slab = freeSlabs.back();
+                freeSlabs.pop_back();
+                slab->used = 0;
+                slab->references.store(1, std::memory_order_relaxed);
+                return slab;
+            }
+        }
+        allocatedBytes.fetch_add(capacity, std::memory_order_relaxed);
+        return new Slab(capacity);
+    }
+
+    void LineArena::unreference(Slab *slab) {
+        if (slab->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        if (slab->capacity == slabSize) {
+            std::lock_guard<std::mutex> lock{freeMutex};
+            if (freeSlabs.size() < maxFreeSlabs) {
+                freeSlabs.push_back(slab);
+                return;
+            }
+        }
+        allocatedBytes.fetch_sub(slab->capacity, std::memory_order_relaxed);
+        delete slab;
+    }
+}
@@ -0,0 +1,298 @@
+#include "direct_ingestion/SpillQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace wavefront {
+    // segments are preallocated at this size; a larger payload gets a segment of its own
+    const static size_t SEGMENT_SIZE = 16 * 1024 * 1024;
+    const static char SEGMENT_MAGIC[8] = {'W', 'F', 'S', 'P', 'I', 'L', 'L', '1'};
+    const static char *SEGMENT_PREFIX = "segment-";
+    const static char *SEGMENT_SUFFIX = ".spill";
+
+    // record states; the zero state of unwritten space marks the end of a segment
+    const static uint32_t RECORD_PENDING = 0x444E4550;   // "PEND"
+    const static uint32_t RECORD_CONSUMED = 0x454E4F44;  // "DONE"
+
+    struct RecordHeader {
+        uint32_t state;
+        uint32_t points;
+        uint64_t length;
+    };
+
+    // records start on 8 byte boundaries
+    static size_t recordSize(size_t length) {
+        return sizeof(RecordHeader) + ((length + 7) & ~static_cast<size_t>(7));
+    }
+
+    struct SpillQueue::Segment {
+        uint64_t sequence;
+        std::string path;
+        int descriptor = -1;
+        char *base = nullptr;
+        size_t capacity = 0;
+        size_t readOffset = sizeof(SEGMENT_MAGIC);
+        size_t writeOffset = sizeof(SEGMENT_MAGIC);
+        // segments loaded from a previous process are not appended to
+        bool sealed = false;
+
+        RecordHeader *header(size_t offset) {
+            return reinterpret_cast<RecordHeader *>(base + offset);
+        }
+    };
+
+    // create the directory and any missing parents
+    static void makeDirectories(const std::string &directory) {
+        for (size_t end = directory.find('/', 1); ; end = directory.find('/', end + 1)) {
+            std::string path = directory.substr(0, end);
+            if (!path.empty() && mkdir(path.c_str(), 0755) < 0 && errno != EEXIST) {
+                throw std::runtime_error("can't create spill directory " + path + ": " + std::strerror(errno));
+            }
+            if (end == std::string::npos)
+                return;
+        }
+    }
+
+    SpillQueue::SpillQueue(const std::string &directory, size_t maxBytes) : directory(directory), maxBytes(maxBytes) {
+        makeDirectories(directory);
+        load();
+    }
+
+    SpillQueue::~SpillQueue() {
+        for (auto &segment : segments) {
+            release(*segment, false);
+        }
+    }
+
+    void SpillQueue::load() {
+        DIR *dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            throw std::runtime_error("can't read spill directory " + directory + ": " + std::strerror(errno));
+        }
+        std::vector<uint64_t> sequences;
+        while (dirent *entry = readdir(dir)) {
+            unsigned long long sequence;
+            char suffix[8];
+            if (std::sscanf(entry->d_name, "segment-%llu%7s", &sequence, suffix) == 2 &&
+                std::strcmp(suffix, SEGMENT_SUFFIX) == 0) {
+                sequences.push_back(sequence);
+            }
+        }
+        closedir(dir);
+        std::sort(sequences.begin(), sequences.end());
+
+        for (uint64_t sequence : sequences) {
+            std::unique_ptr<Segment> segment = openSegment(segmentPath(sequence), sequence);
+            nextSequence = sequence + 1;
+            if (segment == nullptr)
+                continue;
+            if (segment->readOffset == segment->writeOffset) {
+                release(*segment, true);
+                continue;
+            }
+            fileBytes += segment->capacity;
+            segments.push_back(std::move(segment));
+        }
+    }
+
+    std::unique_ptr<SpillQueue::Segment> SpillQueue::openSegment(const std::string &path, uint64_t sequence) {
+        std::unique_ptr<Segment> segment(new Segment());
+        segment->sequence = sequence;
+        segment->path = path;
+        segment->sealed = true;
+        segment->descriptor = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        struct stat status;
+        if (segment->descriptor < 0 || fstat(segment->descriptor, &status) < 0) {
+            throw std::runtime_error("can't open spill segment " + path + ": " + std::strerror(errno));
+        }
+        segment->capacity = static_cast<size_t>(status.st_size);
+        if (segment->capacity < sizeof(SEGMENT_MAGIC)) {
+            release(*segment, true);
+            return nullptr;
+        }
+        void *mapped = mmap(nullptr, segment->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->descriptor, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("can't map spill segment " + path + ": " + std::strerror(errno));
+        }
+        segment->base = static_cast<char *>(mapped);
+        if (std::memcmp(segment->base, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+            std::cerr << "Ignoring unknown spill segment " << path << std::endl;
+            release(*segment, false);
+            return nullptr;
+        }
+
+        // find the end of the written records and the first pending one; a torn record ends the segment
+        bool foundPending = false;
+        size_t offset = sizeof(SEGMENT_MAGIC);
+        while (offset + sizeof(RecordHeader) <= segment->capacity) {
+            RecordHeader *header = segment->header(offset);
+            if ((header->state != RECORD_PENDING && header->state != RECORD_CONSUMED) ||
+                header->length > segment->capacity - offset - sizeof(RecordHeader))
+                break;
+            if (header->state == RECORD_PENDING) {
+                if (!foundPending) {
+                    segment->readOffset = offset;
+                    foundPending = true;
+                }
+                pendingBytes += header->length;
+            }
+            offset += recordSize(header->length);
+        }
+        segment->writeOffset = offset;
+        if (!foundPending) {
+            segment->readOffset = offset;
+        }
+        return segment;
+    }
+
+    std::unique_ptr<SpillQueue::Segment> SpillQueue::createSegment(size_t capacity) {
+        std::unique_ptr<Segment> segment(new Segment());
+        segment->sequence = nextSequence++;
+        segment->path = segmentPath(segment->sequence);
+        segment->capacity = capacity;
+        segment->descriptor = open(segment->path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (segment->descriptor < 0) {
+            std::cerr << "Can't create spill segment " << segment->path << ": " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+        // the file is zero filled, which reads as the end marker
+        if (ftruncate(segment->descriptor, static_cast<off_t>(capacity)) < 0) {
+            std::cerr << "Can't size spill segment " << segment->path << ": " << std::strerror(errno) << std::endl;
+            release(*segment, true);
+            return nullptr;
+        }
+        void *mapped = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->descriptor, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Can't map spill segment " << segment->path << ": " << std::strerror(errno) << std::endl;
+            release(*segment, true);
+            return nullptr;
+        }
+        segment->base = static_cast<char *>(mapped);
+        std::memcpy(segment->base, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+        return segment;
+    }
+
+    bool SpillQueue::append(const char *payload, size_t length, int points) {
+        size_t size = recordSize(length);
+        std::lock_guard<std::mutex> lock{mutex};
+
+        Segment *target = segments.empty() ? nullptr : segments.back().get();
+        // keep room for the end marker after the record
+        if (target == nullptr || target->sealed ||
+            target->writeOffset + size + sizeof(RecordHeader) > target->capacity) {
+            size_t capacity = std::max(SEGMENT_SIZE, sizeof(SEGMENT_MAGIC) + size + sizeof(RecordHeader));
+            if (fileBytes + capacity > maxBytes) {
+                return false;
+            }
+            if (target != nullptr && !target->sealed) {
+                msync(target->base, target->capacity, MS_ASYNC);
+                target->sealed = true;
+            }
+            std::unique_ptr<Segment> segment = createSegment(capacity);
+            if (segment == nullptr) {
+                return false;
+            }
+            fileBytes += capacity;
+            segments.push_back(std::move(segment));
+            target = segments.back().get();
+        }
+
+        RecordHeader *header = target->header(target->writeOffset);
+        header->points = static_cast<uint32_t>(points);
+        header->length = length;
+        std::memcpy(target->base + target->writeOffset + sizeof(RecordHeader), payload, length);
+        // publish the state last so a record torn by a crash reads as the end of the segment
+        std::atomic_thread_fence(std::memory_order_release);
+        header->state = RECORD_PENDING;
+        target->writeOffset += size;
+        pendingBytes += length;
+        return true;
+    }
+
+    bool SpillQueue::peek(const char *&payload, size_t &length, int &points) {
+        std::lock_guard<std::mutex> lock{mutex};
+        // the front segment may have been exhausted before a newer one sealed it
+        advance();
+        if (segments.empty())
+            return false;
+        Segment &front = *segments.front();
+        if (front.readOffset >= front.writeOffset)
+            return false;
+        RecordHeader *header = front.header(front.readOffset);
+        payload = front.base + front.readOffset + sizeof(RecordHeader);
+        length = static_cast<size_t>(header->length);
+        points = static_cast<int>(header->points);
+        return true;
+    }
+
+    void SpillQueue::pop() {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (segments.empty())
+            return;
+        Segment &front = *segments.front();
+        if (front.readOffset >= front.writeOffset)
+            return;
+        RecordHeader *header = front.header(front.readOffset);
+        header->state = RECORD_CONSUMED;
+        pendingBytes -= static_cast<size_t>(header->length);
+        front.readOffset += recordSize(header->length);
+        advance();
+    }
+
+    void SpillQueue::advance() {
+        while (!segments.empty()) {
+            Segment &front = *segments.front();
+            while (front.readOffset < front.writeOffset && front.header(front.readOffset)->state == RECORD_CONSUMED) {
+                front.readOffset += recordSize(front.header(front.readOffset)->length);
+            }
+            // the segment being appended to stays until it is full
+            if (front.readOffset < front.writeOffset || (!front.sealed && segments.size() == 1))
+                return;
+            fileBytes -= front.capacity;
+            release(front, true);
+            segments.pop_front();
+        }
+    }
+
+    bool SpillQueue::empty() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pendingBytes == 0;
+    }
+
+    size_t SpillQueue::getPendingBytes() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pendingBytes;
+    }
+
+    void SpillQueue::release(Segment &segment, bool remove) {
+        if (segment.base != nullptr) {
+            munmap(segment.base, segment.capacity);
+            segment.base = nullptr;
+        }
+        if (segment.descriptor >= 0) {
+            ::close(segment.descriptor);
+            segment.descriptor = -1;
+        }
+        if (remove) {
+            unlink(segment.path.c_str());
+        }
+    }
+
+    std::string SpillQueue::segmentPath(uint64_t sequence) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s%020llu%s", SEGMENT_PREFIX, static_cast<unsigned long long>(sequence),
+                      SEGMENT_SUFFIX);
+        return directory + "/" + name;
+    }
+}
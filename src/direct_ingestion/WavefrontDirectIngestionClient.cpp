@@ -1,23 +1,121 @@
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
 
 #include "direct_ingestion/WavefrontDirectIngestionClient.h"
 #include "common/Serializer.h"
 #include "common/Constants.h"
-#include <boost/algorithm/string/predicate.hpp>
+#include "common/Utils.h"
 
 
 namespace wavefront {
+    const static std::list<SpanLog> NO_SPAN_LOGS;
+    // batches are handed to a lane in entries of about this many bytes
+    const static size_t BATCH_ENTRY_BYTES = 64 * 1024;
+    const static std::string SDK_METRICS_PREFIX = "~sdk.cpp.direct_sender.";
+
+    // scratch buffer of the calling thread for span logs, which embed the span line held in OutputBuffer::threadLocal
+    static OutputBuffer &spanLogBuffer() {
+        static thread_local OutputBuffer scratch(1024);
+        scratch.clear();
+        return scratch;
+    }
 
     WavefrontDirectIngestionClient::WavefrontDirectIngestionClient(WavefrontDirectIngestionClient::Builder *builder)
-            : maxQueueSize(
-            builder->maxQueueSize), batchSize(builder->batchSize), flushIntervalSeconds(builder->flushIntervalSeconds),
+            : failures(0), closeTimeoutSeconds(builder->closeTimeoutSeconds),
               service(builder->serverName,
-                      builder->token) {
+                      builder->token, builder->compressionLevel, builder->idleTimeoutSeconds),
+              retryPolicy(builder->retryOptions), sampler(builder->sampler) {
+        metricsLane.reset(new IngestionLane("metrics", constant::WAVEFRONT_METRIC_FORMAT,
+                                            resolve(builder->metricsLane, builder), service, retryPolicy, selfMetrics,
+                                            builder->streamingCompression, builder->compressionLevel,
+                                            createSpill("metrics", builder)));
+        histogramLane.reset(new IngestionLane("histogram", constant::WAVEFRONT_HISTOGRAM_FORMAT,
+                                              resolve(builder->histogramLane, builder), service, retryPolicy,
+                                              selfMetrics, builder->streamingCompression, builder->compressionLevel,
+                                              createSpill("histogram", builder)));
+        tracingLane.reset(new IngestionLane("span", constant::WAVEFRONT_TRACING_SPAN_FORMAT,
+                                            resolve(builder->tracingLane, builder), service, retryPolicy, selfMetrics,
+                                            builder->streamingCompression, builder->compressionLevel,
+                                            createSpill("span", builder)));
+        spanLogsLane.reset(new IngestionLane("span log", constant::WAVEFRONT_SPAN_LOG_FORMAT,
+                                             resolve(builder->spanLogsLane, builder), service, retryPolicy, selfMetrics,
+                                             builder->streamingCompression, builder->compressionLevel,
+                                             createSpill("spanLogs", builder)));
+        if (builder->sdkMetricsIntervalSeconds > 0) {
+            sdkMetrics.reset(MetricRegistry::Builder(*this)
+                                     .setReportingInterval(builder->sdkMetricsIntervalSeconds).build());
+            SdkMetrics::registerGauges(*sdkMetrics, SDK_METRICS_PREFIX, [this] { return getStats(); });
+            for (IngestionLane *lane : {metricsLane.get(), histogramLane.get(), tracingLane.get(),
+                                        spanLogsLane.get()}) {
+                MetricRegistry::Tags tags{{"lane", lane->getName()}};
+                sdkMetrics->gauge(SDK_METRICS_PREFIX + "lane.queue.points", [lane] {
+                    return static_cast<double>(lane->getGauges().queuedPoints);
+                }, tags);
+                sdkMetrics->gauge(SDK_METRICS_PREFIX + "lane.queue.bytes", [lane] {
+                    return static_cast<double>(lane->getGauges().queuedBytes);
+                }, tags);
+                sdkMetrics->gauge(SDK_METRICS_PREFIX + "lane.arena.bytes", [lane] {
+                    return static_cast<double>(lane->getGauges().arenaBytes);
+                }, tags);
+                sdkMetrics->gauge(SDK_METRICS_PREFIX + "lane.spill.bytes", [lane] {
+                    return static_cast<double>(lane->getGauges().spilledBytes);
+                }, tags);
+            }
+        }
+    }
+
+    LaneOptions WavefrontDirectIngestionClient::resolve(const LaneOptions &options, const Builder *builder) {
+        LaneOptions resolved = options;
+        if (resolved.maxQueueSize <= 0)
+            resolved.maxQueueSize = builder->maxQueueSize;
+        if (resolved.batchSize <= 0)
+            resolved.batchSize = builder->batchSize;
+        if (resolved.maxQueueBytes == 0)
+            resolved.maxQueueBytes = builder->maxQueueBytes > 0 ? builder->maxQueueBytes : SIZE_MAX;
+        if (resolved.batchBytes == 0)
+            resolved.batchBytes = builder->batchBytes > 0 ? builder->batchBytes : SIZE_MAX;
+        if (resolved.flushIntervalSeconds <= 0)
+            resolved.flushIntervalSeconds = builder->flushIntervalSeconds;
+        if (resolved.maxInFlight <= 0)
+            resolved.maxInFlight = builder->maxInFlight > 0 ? builder->maxInFlight : 1;
+        return resolved;
+    }
+
+    std::unique_ptr<SpillQueue> WavefrontDirectIngestionClient::createSpill(const std::string &lane,
+                                                                           const Builder *builder) {
+        if (builder->spillDirectory.empty())
+            return nullptr;
+        try {
+            return std::unique_ptr<SpillQueue>(
+                    new SpillQueue(builder->spillDirectory + "/" + lane, builder->maxSpillBytes));
+        } catch (std::exception &e) {
+            std::cerr << "Spilling of " << lane << " disabled: " << e.what() << std::endl;
+            return nullptr;
+        }
     }
 
     int WavefrontDirectIngestionClient::getFailureCount() {
-        return failures.load();
+        return failures.load() + metricsLane->getFailureCount() + histogramLane->getFailureCount() +
+               tracingLane->getFailureCount() + spanLogsLane->getFailureCount();
+    }
+
+    std::map<std::string, LaneGauges> WavefrontDirectIngestionClient::getLaneGauges() {
+        std::map<std::string, LaneGauges> gauges;
+        for (IngestionLane *lane : {metricsLane.get(), histogramLane.get(), tracingLane.get(), spanLogsLane.get()}) {
+            gauges[lane->getName()] = lane->getGauges();
+        }
+        return gauges;
+    }
+
+    SenderStats WavefrontDirectIngestionClient::getStats() {
+        SenderStats stats = selfMetrics.snapshot();
+        for (IngestionLane *lane : {metricsLane.get(), histogramLane.get(), tracingLane.get(), spanLogsLane.get()}) {
+            LaneGauges gauges = lane->getGauges();
+            stats.queuedPoints += gauges.queuedPoints;
+            stats.queuedBytes += gauges.queuedBytes;
+        }
+        return stats;
     }
 
     void WavefrontDirectIngestionClient::sendDistribution(const std::string &name,
@@ -25,18 +123,34 @@ namespace wavefront {
                                                           std::set<wavefront::HistogramGranularity> histogramGranularities,
                                                           long timestamp, const std::string &source,
                                                           std::map<std::string, std::string> tags) {
+        sendDistributionLine(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    void WavefrontDirectIngestionClient::sendDistribution(const std::string &name,
+                                                          const std::list<std::pair<double, int>> &centroids,
+                                                          const std::set<HistogramGranularity> &histogramGranularities,
+                                                          long timestamp, const std::string &source,
+                                                          const TagSet &tags) {
+        sendDistributionLine(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    template<typename Centroids, typename Granularities, typename Tags>
+    void WavefrontDirectIngestionClient::sendDistributionLine(boost::string_view name, const Centroids &centroids,
+                                                              const Granularities &histogramGranularities,
+                                                              long timestamp, boost::string_view source,
+                                                              const Tags &tags) {
         try {
-            std::string lineData = Serializer::histogramToLineData(name, centroids, histogramGranularities, timestamp,
-                                                                   (source.empty() ? defaultSource : source), tags);
-            // grab the mutex
-            std::lock_guard<std::mutex> lock{mutex};
-            if (histogramBuffer.size() >= maxQueueSize) {
-                std::cerr << "Buffer full, dropping histogram: " << lineData << std::endl;
-            } else {
-                histogramBuffer.push(lineData);
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendHistogram(lineData, name, centroids, histogramGranularities, timestamp,
+                                            (source.empty() ? boost::string_view(defaultSource) : source), tags);
             }
+            selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+            histogramLane->enqueue(lineData);
         } catch (std::invalid_argument e) {
             failures.fetch_add(1);
+            selfMetrics.pointsInvalid.inc();
             std::cerr << e.what() << std::endl;
         }
     }
@@ -44,29 +158,93 @@ namespace wavefront {
     void WavefrontDirectIngestionClient::sendMetric(const std::string &name, double value, long timestamp,
                                                     const std::string &source,
                                                     std::map<std::string, std::string> tags) {
+        sendMetricLine(name, value, timestamp, source, tags);
+    }
+
+    void WavefrontDirectIngestionClient::sendMetric(const std::string &name, double value, long timestamp,
+                                                    const std::string &source, const TagSet &tags) {
+        sendMetricLine(name, value, timestamp, source, tags);
+    }
+
+    template<typename Tags>
+    void WavefrontDirectIngestionClient::sendMetricLine(boost::string_view name, double value, long timestamp,
+                                                        boost::string_view source, const Tags &tags) {
         try {
-            std::string lineData = Serializer::metricsToLineData(name, value, timestamp,
-                                                                 (source.empty() ? defaultSource : source), tags);
-            // grab the mutex
-            std::lock_guard<std::mutex> lock{mutex};
-            if (metricsBuffer.size() >= maxQueueSize) {
-                std::cerr << "Buffer full, dropping metrics: " << lineData << std::endl;
-            } else {
-                metricsBuffer.push(lineData);
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendMetric(lineData, name, value, timestamp,
+                                         (source.empty() ? boost::string_view(defaultSource) : source), tags);
             }
+            selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+            metricsLane->enqueue(lineData);
         } catch (std::invalid_argument e) {
             failures.fetch_add(1);
+            selfMetrics.pointsInvalid.inc();
             std::cerr << e.what() << std::endl;
         }
     }
 
+    void WavefrontDirectIngestionClient::sendMetrics(const std::vector<MetricPoint> &metrics) {
+        OutputBuffer &lineData = OutputBuffer::threadLocal();
+        int points = 0;
+        for (auto &metric : metrics) {
+            try {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                const std::string &source = metric.source.empty() ? defaultSource : metric.source;
+                if (metric.tagSet != nullptr) {
+                    Serializer::appendMetric(lineData, metric.name, metric.value, metric.timestamp, source,
+                                             *metric.tagSet);
+                } else {
+                    Serializer::appendMetric(lineData, metric.name, metric.value, metric.timestamp, source,
+                                             metric.tags);
+                }
+                points++;
+            } catch (std::invalid_argument &e) {
+                failures.fetch_add(1);
+                selfMetrics.pointsInvalid.inc();
+                std::cerr << e.what() << std::endl;
+            }
+            if (lineData.size() >= BATCH_ENTRY_BYTES) {
+                selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+                metricsLane->enqueue(lineData, points);
+                lineData.clear();
+                points = 0;
+            }
+        }
+        if (points > 0) {
+            selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+            metricsLane->enqueue(lineData, points);
+        }
+    }
+
+    std::shared_ptr<const MetricSeries>
+    WavefrontDirectIngestionClient::registerSeries(const std::string &name, const std::string &source,
+                                                   const std::map<std::string, std::string> &tags) {
+        return MetricSeries::create(name, (source.empty() ? defaultSource : source), tags);
+    }
+
+    void WavefrontDirectIngestionClient::sendMetric(const MetricSeries &series, double value, long timestamp) {
+        OutputBuffer &lineData = OutputBuffer::threadLocal();
+        {
+            SdkMetrics::SerializationTimer timer(selfMetrics);
+            Serializer::appendMetric(lineData, series, value, timestamp);
+        }
+        selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+        metricsLane->enqueue(lineData);
+    }
+
     void WavefrontDirectIngestionClient::sendDeltaCounter(std::string &name, double value,
                                                           const std::string &source,
                                                           std::map<std::string, std::string> tags) {
-        if (!boost::starts_with(name, constant::DELTA_PREFIX) && !boost::starts_with(name, constant::DELTA_PREFIX_2)) {
-            name += constant::DELTA_PREFIX;
-        }
-        sendMetric(name, value, -1, source, tags);
+        Utils::add_delta_prefix(name);
+        sendMetricLine(name, value, -1, source, tags);
+    }
+
+    void WavefrontDirectIngestionClient::sendDeltaCounter(std::string &name, double value,
+                                                          const std::string &source, const TagSet &tags) {
+        Utils::add_delta_prefix(name);
+        sendMetricLine(name, value, -1, source, tags);
     }
 
     void WavefrontDirectIngestionClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
@@ -74,78 +252,174 @@ namespace wavefront {
                                                   const std::string &source, std::list<boost::uuids::uuid> parents,
                                                   std::list<boost::uuids::uuid> followsFrom,
                                                   std::map<std::string, std::string> tags) {
-        try {
-            std::string lineData = Serializer::spanToLineData(name, startMillis, durationMillis, traceId, spanId,
-                                                              (source.empty() ? defaultSource : source), parents,
-                                                              followsFrom, tags);
-            // grab the mutex
-            std::lock_guard<std::mutex> lock{mutex};
-            if (tracingBuffer.size() >= maxQueueSize) {
-                std::cerr << "Buffer full, dropping span: " << lineData << std::endl;
-            } else {
-                tracingBuffer.push(lineData);
-            }
-        } catch (std::invalid_argument e) {
-            failures.fetch_add(1);
-            std::cerr << e.what() << std::endl;
-        }
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     NO_SPAN_LOGS);
     }
 
-    void WavefrontDirectIngestionClient::internalFlush(std::queue<std::string> &buffer, const std::string &format) {
-        if (buffer.empty())
-            return;
-        // to decrease contention, using copy buffer
-        std::list<std::string> copy_buffer;
-        int size = std::min((int) buffer.size(), batchSize);
-
-        mutex.lock();
-        for (int i = 0; i < size; i++) {
-            copy_buffer.emplace_back(buffer.front());
-            buffer.pop();
-        }
-        mutex.unlock();
+    void WavefrontDirectIngestionClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                                  boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                                  const std::string &source,
+                                                  const std::list<boost::uuids::uuid> &parents,
+                                                  const std::list<boost::uuids::uuid> &followsFrom,
+                                                  const TagSet &tags) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     NO_SPAN_LOGS);
+    }
 
-        cpr::Response response = service.report(format, copy_buffer);
-        // report error
-        if (response.status_code != static_cast<int>(constant::StatusCode::OK) &&
-            response.status_code != static_cast<int>(constant::StatusCode::ACCEPTED)) {
-            failures.fetch_add(1);
-            // add back if report failed
-            mutex.lock();
-            for (auto &element : copy_buffer) {
-                buffer.push(element);
+    void WavefrontDirectIngestionClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                                  boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                                  const std::string &source,
+                                                  const std::list<boost::uuids::uuid> &parents,
+                                                  const std::list<boost::uuids::uuid> &followsFrom,
+                                                  const std::map<std::string, std::string> &tags,
+                                                  const std::list<SpanLog> &spanLogs) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     spanLogs);
+    }
+
+    void WavefrontDirectIngestionClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                                  boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                                  const std::string &source,
+                                                  const std::list<boost::uuids::uuid> &parents,
+                                                  const std::list<boost::uuids::uuid> &followsFrom,
+                                                  const TagSet &tags, const std::list<SpanLog> &spanLogs) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     spanLogs);
+    }
+
+    void WavefrontDirectIngestionClient::sendMetric(boost::string_view name, double value, long timestamp,
+                                                    boost::string_view source, ArrayView<TagView> tags) {
+        sendMetricLine(name, value, timestamp, source, tags);
+    }
+
+    void WavefrontDirectIngestionClient::sendDistribution(boost::string_view name,
+                                                          ArrayView<std::pair<double, int>> centroids,
+                                                          ArrayView<HistogramGranularity> histogramGranularities,
+                                                          long timestamp, boost::string_view source,
+                                                          ArrayView<TagView> tags) {
+        sendDistributionLine(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    void WavefrontDirectIngestionClient::sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                                                  const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                                                  boost::string_view source, ArrayView<boost::uuids::uuid> parents,
+                                                  ArrayView<boost::uuids::uuid> followsFrom, ArrayView<TagView> tags) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     NO_SPAN_LOGS);
+    }
+
+    void WavefrontDirectIngestionClient::sendSpans(const std::vector<SpanPoint> &spans) {
+        OutputBuffer &lineData = OutputBuffer::threadLocal();
+        OutputBuffer &logData = spanLogBuffer();
+        int points = 0;
+        int logPoints = 0;
+        for (auto &span : spans) {
+            if (sampler != nullptr && !sampler->sample(span.name, span.traceId, span.durationMillis))
+                continue;
+            try {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                size_t start = lineData.size();
+                const std::string &source = span.source.empty() ? defaultSource : span.source;
+                if (span.tagSet != nullptr) {
+                    Serializer::appendSpan(lineData, span.name, span.startMillis, span.durationMillis, span.traceId,
+                                           span.spanId, source, span.parents, span.followsFrom, *span.tagSet,
+                                           !span.spanLogs.empty());
+                } else {
+                    Serializer::appendSpan(lineData, span.name, span.startMillis, span.durationMillis, span.traceId,
+                                           span.spanId, source, span.parents, span.followsFrom, span.tags,
+                                           !span.spanLogs.empty());
+                }
+                points++;
+                if (!span.spanLogs.empty()) {
+                    Serializer::appendSpanLogs(logData, span.traceId, span.spanId, span.spanLogs,
+                                               lineData.data() + start, lineData.size() - start - 1);
+                    logPoints++;
+                }
+            } catch (std::invalid_argument &e) {
+                failures.fetch_add(1);
+                selfMetrics.pointsInvalid.inc();
+                std::cerr << e.what() << std::endl;
+            }
+            if (lineData.size() >= BATCH_ENTRY_BYTES) {
+                selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+                tracingLane->enqueue(lineData, points);
+                lineData.clear();
+                points = 0;
+            }
+            if (logData.size() >= BATCH_ENTRY_BYTES) {
+                selfMetrics.bytesSerialized.inc(static_cast<long>(logData.size()));
+                spanLogsLane->enqueue(logData, logPoints);
+                logData.clear();
+                logPoints = 0;
             }
-            mutex.unlock();
-            std::cerr << "Error reporting points, respStatus = " + std::to_string(response.status_code) +
-                         " [" + response.error.message + "] " << std::endl;
-        } else {
-            std::cout << "report points succeed: " << response.status_code << std::endl;
+        }
+        if (points > 0) {
+            selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+            tracingLane->enqueue(lineData, points);
+        }
+        if (logPoints > 0) {
+            selfMetrics.bytesSerialized.inc(static_cast<long>(logData.size()));
+            spanLogsLane->enqueue(logData, logPoints);
         }
     }
 
-    void WavefrontDirectIngestionClient::flush() {
-        internalFlush(metricsBuffer, constant::WAVEFRONT_METRIC_FORMAT);
-        internalFlush(histogramBuffer, constant::WAVEFRONT_HISTOGRAM_FORMAT);
-        internalFlush(tracingBuffer, constant::WAVEFRONT_TRACING_SPAN_FORMAT);
-    }
+    template<typename Ids, typename Tags>
+    void WavefrontDirectIngestionClient::sendSpanLine(boost::string_view name, long startMillis, long durationMillis,
+                                                      const boost::uuids::uuid &traceId,
+                                                      const boost::uuids::uuid &spanId, boost::string_view source,
+                                                      const Ids &parents, const Ids &followsFrom, const Tags &tags,
+                                                      const std::list<SpanLog> &spanLogs) {
+        if (sampler != nullptr && !sampler->sample(name, traceId, durationMillis))
+            return;
 
-    void WavefrontDirectIngestionClient::flushTask() {
-        while (is_running) {
-            std::this_thread::sleep_for(std::chrono::seconds(flushIntervalSeconds));
-            flush();
+        try {
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendSpan(lineData, name, startMillis, durationMillis, traceId, spanId,
+                                       (source.empty() ? boost::string_view(defaultSource) : source), parents,
+                                       followsFrom, tags, !spanLogs.empty());
+            }
+            selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+            tracingLane->enqueue(lineData);
+            if (!spanLogs.empty()) {
+                OutputBuffer &logData = spanLogBuffer();
+                Serializer::appendSpanLogs(logData, traceId, spanId, spanLogs, lineData.data(), lineData.size() - 1);
+                selfMetrics.bytesSerialized.inc(static_cast<long>(logData.size()));
+                spanLogsLane->enqueue(logData);
+            }
+        } catch (std::invalid_argument e) {
+            failures.fetch_add(1);
+            selfMetrics.pointsInvalid.inc();
+            std::cerr << e.what() << std::endl;
         }
     }
 
     void WavefrontDirectIngestionClient::start() {
-        // start flushing thread
-        is_running.store(true);
-        t = std::thread(&WavefrontDirectIngestionClient::flushTask, this);
+        // start flushing threads
+        metricsLane->start();
+        histogramLane->start();
+        tracingLane->start();
+        spanLogsLane->start();
+        if (sdkMetrics != nullptr) {
+            sdkMetrics->start();
+        }
     }
 
     void WavefrontDirectIngestionClient::close() {
-        // Flush before closing
-        flush();
-        is_running.store(false);
-        t.join();
+        // the final report of the client's own stats goes out with everything else
+        if (sdkMetrics != nullptr) {
+            sdkMetrics->close();
+        }
+        // Flush before closing: the lanes drain concurrently until everything is reported or the deadline passes
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(closeTimeoutSeconds);
+        metricsLane->stop(deadline);
+        histogramLane->stop(deadline);
+        tracingLane->stop(deadline);
+        spanLogsLane->stop(deadline);
+        metricsLane->join();
+        histogramLane->join();
+        tracingLane->join();
+        spanLogsLane->join();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace wavefront {
+    /**
+    * Borrowed view of a contiguous array, for the WavefrontSender overloads that read their arguments in place.
+    * The viewed elements must stay valid for the duration of the call.
+    *
+    * A view is made from a vector, an array or a pointer and a length. Braced lists deliberately don't convert
+    * to a view, so that calls like sendMetric(name, value, ts, source, {{"k", "v"}}) keep resolving to the
+    * overloads taking containers.
+    */
+    template<typename T>
+    class ArrayView {
+    public:
+        ArrayView(const T *data, size_t length) : elements(data), length(length) {
+        }
+
+        template<typename U, size_t N, typename = typename std::enable_if<
+                std::is_same<typename std::remove_const<U>::type, T>::value>::type>
+        ArrayView(U (&array)[N]) : elements(array), length(N) {
+        }
+
+        template<typename Allocator>
+        ArrayView(const std::vector<T, Allocator> &vector) : elements(vector.data()), length(vector.size()) {
+        }
+
+        inline const T *data() const {
+            return elements;
+        }
+
+        inline size_t size() const {
+            return length;
+        }
+
+        inline bool empty() const {
+            return length == 0;
+        }
+
+        inline const T *begin() const {
+            return elements;
+        }
+
+        inline const T *end() const {
+            return elements + length;
+        }
+
+        inline const T &operator[](size_t index) const {
+            return elements[index];
+        }
+
+    private:
+        const T *elements;
+        size_t length;
+    };
+
+    // a point tag as a borrowed key and value
+    typedef std::pair<boost::string_view, boost::string_view> TagView;
+}
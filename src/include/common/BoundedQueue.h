@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace wavefront {
+    /**
+    * Bounded lock-free queue for any number of producers and consumers, after Dmitry Vyukov's
+    * bounded MPMC queue. Every slot carries a sequence number that tells producers and consumers
+    * whether it is free or filled for their position, so a push or pop is one CAS on the shared
+    * position plus a release store on the slot, and producers never contend on a lock.
+    *
+    * Slots are allocated up front; the queue holds at most capacity elements. The sequence scheme needs
+    * at least two slots, so smaller capacities are rounded up to 2.
+    */
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity) : slotCount(capacity < 2 ? 2 : capacity),
+                                                 slots(new Slot[capacity < 2 ? 2 : capacity]) {
+            for (size_t i = 0; i < slotCount; i++) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            enqueuePosition.store(0, std::memory_order_relaxed);
+            dequeuePosition.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * Append value unless the queue is full.
+         *
+         * @return false if the queue is full, in which case value is left untouched
+         */
+        bool tryPush(T &&value) {
+            Slot *slot;
+            size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            for (;;) {
+                slot = &slots[position % slotCount];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0) {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+            slot->value = std::move(value);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Remove the oldest element into value.
+         *
+         * @return false if the queue is empty
+         */
+        bool tryPop(T &value) {
+            Slot *slot;
+            size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            for (;;) {
+                slot = &slots[position % slotCount];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                if (difference == 0) {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+            value = std::move(slot->value);
+            slot->sequence.store(position + slotCount, std::memory_order_release);
+            return true;
+        }
+
+        // number of queued elements; only a snapshot while producers or consumers are active
+        size_t size() const {
+            size_t dequeued = dequeuePosition.load(std::memory_order_acquire);
+            size_t enqueued = enqueuePosition.load(std::memory_order_acquire);
+            return enqueued > dequeued ? enqueued - dequeued : 0;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        size_t capacity() const {
+            return slotCount;
+        }
+
+    private:
+        BoundedQueue(const BoundedQueue &);
+
+        BoundedQueue &operator=(const BoundedQueue &);
+
+        static const size_t CACHE_LINE_SIZE = 64;
+
+        struct Slot {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        const size_t slotCount;
+        const std::unique_ptr<Slot[]> slots;
+        // keep producers and consumers from invalidating each other's cache line
+        char padding0[CACHE_LINE_SIZE];
+        std::atomic<size_t> enqueuePosition;
+        char padding1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> dequeuePosition;
+        char padding2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    };
+}
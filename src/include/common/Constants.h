@@ -24,6 +24,11 @@ namespace wavefront {
          */
         const static std::string WAVEFRONT_TRACING_SPAN_FORMAT = "trace";
 
+        /**
+         * Use this format to send span logs to Wavefront
+         */
+        const static std::string WAVEFRONT_SPAN_LOG_FORMAT = "spanLogs";
+
         /**
          * ∆: INCREMENT
          */
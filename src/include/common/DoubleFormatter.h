@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace wavefront {
+    /**
+    * Shortest round-trip formatting of doubles, based on the Grisu2 algorithm by Florian Loitsch
+    * ("Printing Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010).
+    *
+    * The output always parses back to exactly the same double and is the shortest such string for
+    * all but a tiny fraction of inputs, where it may carry one extra digit. Integral values are printed
+    * without a fraction ("42422"), very large and very small magnitudes in exponent notation ("1e-9").
+    */
+    class DoubleFormatter {
+    public:
+        // buffer size that is always sufficient for format()
+        static const size_t MAX_LENGTH = 32;
+
+        /**
+         * Write the shortest representation of a finite value into buffer, which must hold at least
+         * MAX_LENGTH bytes. No terminating NUL is written.
+         *
+         * @return the number of bytes written
+         */
+        static size_t format(double value, char *buffer);
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace wavefront {
+    /**
+    * Locates the characters the Serializer has to escape ('\\', '"' and '\n').
+    *
+    * On x86 the scan compares 32 (AVX2) or 16 (SSE2) bytes at a time. The widest instruction set
+    * supported by the running CPU is picked on first use; other platforms use the scalar loop.
+    */
+    class EscapeScanner {
+    public:
+        /**
+         * @return the index of the first character in data that needs escaping, or length if there is none
+         */
+        static size_t find(const char *data, size_t length);
+
+        // byte-at-a-time reference implementation, also used as the fallback
+        static size_t findScalar(const char *data, size_t length);
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <zlib.h>
+#include "OutputBuffer.h"
+
+namespace wavefront {
+    /**
+    * Incremental gzip compressor over a persistent zlib deflate stream. Data is compressed as it is written, so
+    * finishing a payload only has to compress what arrived since the last write. reset() starts a new gzip
+    * member while keeping the deflate state allocation and the output buffer capacity.
+    *
+    * Not thread-safe; a compressor is owned by the thread that feeds it.
+    */
+    class GzipCompressor {
+    public:
+        /**
+         * @param level zlib compression level, 1 (fastest) to 9 (smallest), 0 to store or -1 for the zlib default
+         * @throws std::invalid_argument if the level is out of range
+         */
+        explicit GzipCompressor(int level = Z_DEFAULT_COMPRESSION);
+
+        ~GzipCompressor();
+
+        void write(const char *data, size_t length);
+
+        // complete the gzip member; the payload stays in getOutput() until reset()
+        void finish();
+
+        void reset();
+
+        inline OutputBuffer &getOutput() {
+            return output;
+        }
+
+        // uncompressed bytes written since the last reset
+        inline size_t getBytesIn() const {
+            return bytesIn;
+        }
+
+        inline bool empty() const {
+            return bytesIn == 0;
+        }
+
+    private:
+        GzipCompressor(const GzipCompressor &);
+
+        GzipCompressor &operator=(const GzipCompressor &);
+
+        void deflateInto(int flush);
+
+        z_stream stream;
+        OutputBuffer output;
+        size_t bytesIn = 0;
+        bool finished = false;
+    };
+}
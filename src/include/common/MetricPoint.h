@@ -0,0 +1,22 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include "TagSet.h"
+
+namespace wavefront {
+    /**
+    * A metric point of a batch handed to WavefrontSender::sendMetrics. The fields have the meaning of the
+    * parameters of WavefrontSender::sendMetric.
+    */
+    struct MetricPoint {
+        std::string name;
+        double value = 0;
+        long timestamp = -1;
+        std::string source;
+        std::map<std::string, std::string> tags;
+        // tags serialized ahead of time, sent instead of tags when set, see TagSet::intern
+        std::shared_ptr<const TagSet> tagSet;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include "TagSet.h"
+
+namespace wavefront {
+    /**
+    * Handle to a metric series (name, source and tags) registered with a WavefrontSender.
+    *
+    * Everything in a metric line except the value and the timestamp is serialized once, at registration,
+    * so sending a point to the series only formats the two numbers.
+    */
+    class MetricSeries {
+    public:
+        /**
+         * Build a series handle.
+         *
+         * @throws std::invalid_argument if name is empty
+         */
+        static std::shared_ptr<const MetricSeries>
+        create(const std::string &name, const std::string &source, const std::map<std::string, std::string> &tags);
+
+        inline const std::string &getName() const {
+            return name;
+        }
+
+        inline const std::string &getSource() const {
+            return source;
+        }
+
+        inline const std::shared_ptr<const TagSet> &getTags() const {
+            return tags;
+        }
+
+        // serialized line up to the value: '"<name>" '
+        inline const std::string &getPrefix() const {
+            return prefix;
+        }
+
+        // serialized line after the timestamp: 'source="<source>" [pointTags]\n'
+        inline const std::string &getSuffix() const {
+            return suffix;
+        }
+
+    private:
+        MetricSeries(const std::string &name, const std::string &source, std::shared_ptr<const TagSet> tags,
+                     std::string prefix, std::string suffix);
+
+        MetricSeries(const MetricSeries &);
+
+        MetricSeries &operator=(const MetricSeries &);
+
+        const std::string name;
+        const std::string source;
+        const std::shared_ptr<const TagSet> tags;
+        const std::string prefix;
+        const std::string suffix;
+    };
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace wavefront {
+    /**
+    * Growable byte buffer the Serializer appends line data into. Clearing the buffer keeps its capacity, so a
+    * buffer that is reused across points stops allocating once it has grown to the size of the largest line.
+    */
+    class OutputBuffer {
+    public:
+        explicit OutputBuffer(size_t initialCapacity = 256) {
+            reserve(initialCapacity);
+        }
+
+        ~OutputBuffer() {
+            std::free(buffer);
+        }
+
+        OutputBuffer(OutputBuffer &&other) noexcept : buffer(other.buffer), length(other.length),
+                                                      capacity(other.capacity) {
+            other.buffer = nullptr;
+            other.length = 0;
+            other.capacity = 0;
+        }
+
+        OutputBuffer &operator=(OutputBuffer &&other) noexcept {
+            if (this != &other) {
+                std::free(buffer);
+                buffer = other.buffer;
+                length = other.length;
+                capacity = other.capacity;
+                other.buffer = nullptr;
+                other.length = 0;
+                other.capacity = 0;
+            }
+            return *this;
+        }
+
+        inline const char *data() const {
+            return buffer;
+        }
+
+        inline size_t size() const {
+            return length;
+        }
+
+        inline bool empty() const {
+            return length == 0;
+        }
+
+        // drop the content but keep the allocated capacity for the next line
+        inline void clear() {
+            length = 0;
+        }
+
+        // shrink the content back to a previously observed size, e.g. to discard a partially written line
+        inline void truncate(size_t newLength) {
+            if (newLength < length) {
+                length = newLength;
+            }
+        }
+
+        void reserve(size_t newCapacity) {
+            if (newCapacity <= capacity) {
+                return;
+            }
+            char *grown = static_cast<char *>(std::realloc(buffer, newCapacity));
+            if (grown == nullptr) {
+                throw std::bad_alloc();
+            }
+            buffer = grown;
+            capacity = newCapacity;
+        }
+
+        /**
+         * Make room for n more bytes and return a pointer to them. The caller must fill the bytes it uses and
+         * then call commit() with the number actually written.
+         */
+        inline char *prepare(size_t n) {
+            if (length + n > capacity) {
+                grow(length + n);
+            }
+            return buffer + length;
+        }
+
+        inline void commit(size_t n) {
+            length += n;
+        }
+
+        inline void append(const char *value, size_t n) {
+            std::memcpy(prepare(n), value, n);
+            length += n;
+        }
+
+        inline void append(const std::string &value) {
+            append(value.data(), value.size());
+        }
+
+        inline void push_back(char c) {
+            *prepare(1) = c;
+            ++length;
+        }
+
+        inline std::string str() const {
+            return std::string(buffer, length);
+        }
+
+        /**
+         * Scratch buffer owned by the calling thread, returned empty. It is shared by every caller on the thread,
+         * so the content must be consumed before the next call.
+         */
+        static OutputBuffer &threadLocal() {
+            static thread_local OutputBuffer scratch(1024);
+            scratch.clear();
+            return scratch;
+        }
+
+    private:
+        OutputBuffer(const OutputBuffer &);
+
+        OutputBuffer &operator=(const OutputBuffer &);
+
+        void grow(size_t required) {
+            size_t newCapacity = capacity < 64 ? 64 : capacity * 2;
+            while (newCapacity < required) {
+                newCapacity *= 2;
+            }
+            reserve(newCapacity);
+        }
+
+        char *buffer = nullptr;
+        size_t length = 0;
+        size_t capacity = 0;
+    };
+}
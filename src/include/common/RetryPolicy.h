@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace wavefront {
+    /**
+    * Tuning of a RetryPolicy.
+    */
+    struct RetryOptions {
+        // delay before the first retry, doubled for every further attempt
+        int initialBackoffMillis = 1000;
+        int maxBackoffMillis = 60 * 1000;
+        // attempts of one payload, including the first, before it is dropped; 0 retries forever
+        int maxAttempts = 5;
+        // fraction of each delay that is randomized, so that clients failing together don't retry together
+        double jitter = 0.5;
+    };
+
+    /**
+    * Retry schedule shared by the senders: exponential backoff with jitter, a bound on the attempts per payload
+    * and the classification of report responses. Counts the retries it schedules and the payloads given up on.
+    *
+    * Thread-safe; one policy serves every lane or connection of a sender.
+    */
+    class RetryPolicy {
+    public:
+        enum class Outcome {
+            SUCCESS,
+            // server errors, throttling and transport failures, which may succeed later
+            RETRY,
+            // other client errors, which a retry of the same payload can't fix
+            REJECT
+        };
+
+        explicit RetryPolicy(const RetryOptions &options = RetryOptions());
+
+        // outcome of an HTTP report, where status 0 means no response was received
+        static Outcome classify(int statusCode);
+
+        // jittered delay before the given retry of a payload, 1 for the first; counted as a retry
+        std::chrono::milliseconds backoff(int attempt);
+
+        // whether a payload that failed this many attempts may be tried again
+        inline bool canRetry(int attempts) const {
+            return options.maxAttempts <= 0 || attempts < options.maxAttempts;
+        }
+
+        inline void recordGiveUp() {
+            givenUp.fetch_add(1);
+        }
+
+        inline void recordRejected() {
+            rejected.fetch_add(1);
+        }
+
+        inline long getRetryCount() const {
+            return retries.load();
+        }
+
+        // payloads dropped after maxAttempts retryable failures
+        inline long getGiveUpCount() const {
+            return givenUp.load();
+        }
+
+        // payloads dropped because they were rejected
+        inline long getRejectedCount() const {
+            return rejected.load();
+        }
+
+    private:
+        RetryOptions options;
+        std::atomic<long> retries;
+        std::atomic<long> givenUp;
+        std::atomic<long> rejected;
+    };
+}
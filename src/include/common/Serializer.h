@@ -3,13 +3,20 @@
 #include <string>
 #include <map>
 #include <cmath>
-#include <sstream>
 #include <list>
 #include <set>
+#include <stdexcept>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include "ArrayView.h"
+#include "DoubleFormatter.h"
+#include "EscapeScanner.h"
 #include "HistogramGranularity.h"
+#include "MetricSeries.h"
+#include "OutputBuffer.h"
+#include "SpanLog.h"
+#include "TagSet.h"
 
 namespace wavefront {
     /**
@@ -29,7 +36,8 @@ namespace wavefront {
             if (std::isinf(v)) {
                 return (v < 0 ? "-Inf" : "+Inf");
             }
-            return std::to_string(v);
+            char digits[DoubleFormatter::MAX_LENGTH];
+            return std::string(digits, DoubleFormatter::format(v, digits));
         }
 
         // Write a HistogramGranularity as a string
@@ -50,46 +58,119 @@ namespace wavefront {
         }
 
         const static std::string escapeCharacter(const std::string &value) {
-            bool copy = false;
-            std::string temp = "";
-
-            for (size_t i = 0; i < value.size(); ++i) {
-                char c = value[i];
-                if (c == '\\' || c == '"' || c == '\n') {
-                    if (!copy) {
-                        temp.reserve(value.size() + 1);
-                        temp.assign(value, 0, i);
-                        copy = true;
-                    }
-                    if (c == '\\') {
-                        temp.append("\\\\");
-                    } else if (c == '"') {
-                        temp.append("\\\"");
-                    } else {
-                        temp.append("\\\n");
-                    }
-                } else if (copy) {
-                    temp.push_back(c);
+            if (EscapeScanner::find(value.data(), value.size()) == value.size()) {
+                return value;
+            }
+            OutputBuffer out(value.size() + 8);
+            appendEscaped(out, value);
+            return out.str();
+        }
+
+        // Append the escaped form of value, as produced by escapeCharacter, without building an intermediate string
+        static void appendEscaped(OutputBuffer &out, boost::string_view value) {
+            const char *run = value.data();
+            size_t remaining = value.size();
+
+            for (;;) {
+                size_t next = EscapeScanner::find(run, remaining);
+                out.append(run, next);
+                if (next == remaining) {
+                    return;
                 }
+                out.push_back('\\');
+                out.push_back(run[next]);
+                run += next + 1;
+                remaining -= next + 1;
+            }
+        }
+
+        // Append value escaped and wrapped in double quotes
+        static void appendQuoted(OutputBuffer &out, boost::string_view value) {
+            out.push_back('"');
+            appendEscaped(out, value);
+            out.push_back('"');
+        }
+
+        // Append a signed integer in decimal
+        static void appendLong(OutputBuffer &out, long value) {
+            char digits[24];
+            char *end = digits + sizeof(digits);
+            char *p = end;
+            unsigned long magnitude = value < 0 ? 0UL - static_cast<unsigned long>(value)
+                                                : static_cast<unsigned long>(value);
+            do {
+                *--p = static_cast<char>('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude != 0);
+            if (value < 0) {
+                *--p = '-';
             }
-            return copy ? temp : value;
+            out.append(p, end - p);
         }
 
-        void static appendTagMap(std::stringstream &out, std::map<std::string, std::string> tags) {
-            if (tags.empty())
+        // Append a metric value or centroid mean, formatted the same way as toString(double)
+        static void appendDouble(OutputBuffer &out, double v) {
+            if (std::isnan(v)) {
+                out.append("Nan", 3);
                 return;
+            }
+            if (std::isinf(v)) {
+                out.append(v < 0 ? "-Inf" : "+Inf", 4);
+                return;
+            }
+            out.commit(DoubleFormatter::format(v, out.prepare(DoubleFormatter::MAX_LENGTH)));
+        }
 
+        static void appendTagMap(OutputBuffer &out, const std::map<std::string, std::string> &tags) {
             for (auto &tag : tags) {
-                out << " " << quote << escapeCharacter(tag.first) << quote << "=" << quote
-                    << escapeCharacter(tag.second)
-                    << quote;
+                out.push_back(' ');
+                appendQuoted(out, tag.first);
+                out.push_back('=');
+                appendQuoted(out, tag.second);
             }
         }
 
+        static void appendTags(OutputBuffer &out, const std::map<std::string, std::string> &tags) {
+            appendTagMap(out, tags);
+        }
 
-        static std::string
-        metricsToLineData(const std::string &name, double value, long timestamp, const std::string &source,
-                          std::map<std::string, std::string> tags) {
+        // tags of a TagSet are escaped and serialized already, copy them as they are
+        static void appendTags(OutputBuffer &out, const TagSet &tags) {
+            out.append(tags.getSerialized());
+        }
+
+        // borrowed tags are written in the order given
+        static void appendTags(OutputBuffer &out, ArrayView<TagView> tags) {
+            for (auto &tag : tags) {
+                out.push_back(' ');
+                appendQuoted(out, tag.first);
+                out.push_back('=');
+                appendQuoted(out, tag.second);
+            }
+        }
+
+        static void appendUuid(OutputBuffer &out, const boost::uuids::uuid &id) {
+            static const char hex[] = "0123456789abcdef";
+            char *p = out.prepare(36);
+            size_t i = 0;
+            for (auto it = id.begin(); it != id.end(); ++it, ++i) {
+                if (i == 4 || i == 6 || i == 8 || i == 10) {
+                    *p++ = '-';
+                }
+                *p++ = hex[(*it >> 4) & 0x0F];
+                *p++ = hex[*it & 0x0F];
+            }
+            out.commit(36);
+        }
+
+        /**
+        * Append a metric line in the Wavefront Metrics Data format to out.
+        * Tags are a tag map, a TagSet or borrowed TagViews. Nothing is written if the arguments are invalid.
+        */
+        template<typename Tags>
+        static void
+        appendMetric(OutputBuffer &out, boost::string_view name, double value, long timestamp,
+                     boost::string_view source, const Tags &tags) {
             /*
             * Wavefront Metrics Data format
             * <metricName> <metricValue> [<timestamp>] source=<source> [pointTags]
@@ -99,24 +180,44 @@ namespace wavefront {
             if (name.empty()) {
                 throw std::invalid_argument("metrics name can't be empty");
             }
-            std::stringstream ss;
-
-            ss << quote << escapeCharacter(name) << quote << " ";
-            ss << toString(value) << " ";
+            appendQuoted(out, name);
+            out.push_back(' ');
+            appendDouble(out, value);
+            out.push_back(' ');
             if (timestamp != -1) {
-                ss << (timestamp / 1000) << " ";
+                appendLong(out, timestamp / 1000);
+                out.push_back(' ');
             }
-            ss << "source=" << quote << escapeCharacter(source) << quote;
-            appendTagMap(ss, tags);
-            ss << "\n";
+            out.append("source=", 7);
+            appendQuoted(out, source);
+            appendTags(out, tags);
+            out.push_back('\n');
+        }
 
-            return ss.str();
+        /**
+        * Append a metric line for a registered series to out; only the value and the timestamp are formatted.
+        */
+        static void appendMetric(OutputBuffer &out, const MetricSeries &series, double value, long timestamp) {
+            out.append(series.getPrefix());
+            appendDouble(out, value);
+            out.push_back(' ');
+            if (timestamp != -1) {
+                appendLong(out, timestamp / 1000);
+                out.push_back(' ');
+            }
+            out.append(series.getSuffix());
         }
 
-        static std::string
-        histogramToLineData(const std::string &name, std::list<std::pair<double, int>> centroids,
-                            std::set<wavefront::HistogramGranularity> histogramGranularities, long timestamp,
-                            const std::string &source, std::map<std::string, std::string> tags) {
+        /**
+        * Append one histogram line per granularity to out.
+        * Centroids are any range of (mean, count) pairs and granularities any range of HistogramGranularity.
+        * Tags are a tag map, a TagSet or borrowed TagViews. Nothing is written if the arguments are invalid.
+        */
+        template<typename Centroids, typename Granularities, typename Tags>
+        static void
+        appendHistogram(OutputBuffer &out, boost::string_view name, const Centroids &centroids,
+                        const Granularities &histogramGranularities, long timestamp, boost::string_view source,
+                        const Tags &tags) {
             if (name.empty()) {
                 throw std::invalid_argument("histogram name cannot be blank");
             }
@@ -129,31 +230,44 @@ namespace wavefront {
                 throw std::invalid_argument("A distribution should have at least one centroid");
             }
 
-            std::stringstream ss;
             for (auto &histogramGranularity : histogramGranularities) {
-                ss << toString(histogramGranularity) << " ";
+                out.append(toString(histogramGranularity));
+                out.push_back(' ');
                 if (timestamp != -1) {
-                    ss << (timestamp / 1000) << " ";
+                    appendLong(out, timestamp / 1000);
+                    out.push_back(' ');
                 }
                 // centroids
                 for (auto &centroid : centroids) {
-                    ss << "#" << centroid.second << " " << centroid.first << " ";
+                    out.push_back('#');
+                    appendLong(out, centroid.second);
+                    out.push_back(' ');
+                    appendDouble(out, centroid.first);
+                    out.push_back(' ');
                 }
                 // Metric
-                ss << quote << escapeCharacter(name) << quote << " ";
+                appendQuoted(out, name);
+                out.push_back(' ');
 
                 // Source
-                ss << "source=" << quote << escapeCharacter(source) << quote;
-                appendTagMap(ss, tags);
-                ss << "\n";
+                out.append("source=", 7);
+                appendQuoted(out, source);
+                appendTags(out, tags);
+                out.push_back('\n');
             }
-            return ss.str();
         }
 
-        static std::string spanToLineData(const std::string &name, long startMillis, long durationMillis,
-                                   boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
-                                   std::list<boost::uuids::uuid> parents, std::list<boost::uuids::uuid> followsFrom,
-                                   std::map<std::string, std::string> tags){
+        /**
+        * Append a span line in the Wavefront Tracing Span Data format to out.
+        * Parents and followsFrom are any range of UUIDs.
+        * Tags are a tag map, a TagSet or borrowed TagViews. A span with span logs is tagged _spanLogs=true, which links it
+        * to the logs sent with appendSpanLogs. Nothing is written if the arguments are invalid.
+        */
+        template<typename Ids, typename Tags>
+        static void appendSpan(OutputBuffer &out, boost::string_view name, long startMillis, long durationMillis,
+                               const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                               boost::string_view source, const Ids &parents, const Ids &followsFrom,
+                               const Tags &tags, bool hasSpanLogs = false) {
             /*
             * Wavefront Tracing Span Data format
             * <tracingSpanName> source=<source> [pointTags] <start_millis> <duration_milli_seconds>
@@ -168,31 +282,145 @@ namespace wavefront {
             if (name.empty()) {
                 throw std::invalid_argument("tracing name cannot be blank");
             }
-            std::stringstream ss;
-            ss << quote << escapeCharacter(name) << quote << " ";
+            appendQuoted(out, name);
+            out.push_back(' ');
             // Source
-            ss << "source=" << quote << escapeCharacter(source) << quote << " ";
-            ss << "traceId=" << boost::uuids::to_string(traceId) << " ";
-            ss << "spanId=" << boost::uuids::to_string(spanId) << " ";
-            if(!parents.empty()){
-                for(auto &parent : parents){
-                    ss << "parent=" << boost::uuids::to_string(parent) << " ";
+            out.append("source=", 7);
+            appendQuoted(out, source);
+            out.append(" traceId=", 9);
+            appendUuid(out, traceId);
+            out.append(" spanId=", 8);
+            appendUuid(out, spanId);
+            out.push_back(' ');
+            for (auto &parent : parents) {
+                out.append("parent=", 7);
+                appendUuid(out, parent);
+                out.push_back(' ');
+            }
+            for (auto &follow : followsFrom) {
+                out.append("followsFrom=", 12);
+                appendUuid(out, follow);
+                out.push_back(' ');
+            }
+            appendTags(out, tags);
+            if (hasSpanLogs) {
+                out.append(" \"_spanLogs\"=\"true\"", 19);
+            }
+            out.push_back(' ');
+            appendLong(out, startMillis);
+            out.push_back(' ');
+            appendLong(out, durationMillis);
+            out.push_back('\n');
+        }
+
+        // Append value as a JSON string, escaping quotes, backslashes and control characters
+        static void appendJsonString(OutputBuffer &out, const char *value, size_t length) {
+            static const char hex[] = "0123456789abcdef";
+            out.push_back('"');
+            size_t run = 0;
+            for (size_t i = 0; i < length; i++) {
+                unsigned char c = static_cast<unsigned char>(value[i]);
+                if (c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+                out.append(value + run, i - run);
+                run = i + 1;
+                out.push_back('\\');
+                switch (c) {
+                    case '"':
+                    case '\\':
+                        out.push_back(static_cast<char>(c));
+                        break;
+                    case '\n':
+                        out.push_back('n');
+                        break;
+                    case '\r':
+                        out.push_back('r');
+                        break;
+                    case '\t':
+                        out.push_back('t');
+                        break;
+                    default:
+                        out.append("u00", 3);
+                        out.push_back(hex[c >> 4]);
+                        out.push_back(hex[c & 0x0F]);
                 }
             }
+            out.append(value + run, length - run);
+            out.push_back('"');
+        }
+
+        static void appendJsonString(OutputBuffer &out, boost::string_view value) {
+            appendJsonString(out, value.data(), value.size());
+        }
 
-            if(!followsFrom.empty()){
-                for(auto &follow : followsFrom){
-                    ss << "followsFrom=" << boost::uuids::to_string(follow) << " ";
+        /**
+        * Append the span logs of a span as one line of JSON in the Wavefront span logs format to out.
+        *
+        * @param span the span line the logs belong to, as written by appendSpan, without its trailing newline
+        */
+        static void appendSpanLogs(OutputBuffer &out, const boost::uuids::uuid &traceId,
+                                   const boost::uuids::uuid &spanId, const std::list<SpanLog> &spanLogs,
+                                   const char *span, size_t spanLength) {
+            /*
+            * Wavefront span logs format
+            * {"customer":"default","traceId":<traceId>,"spanId":<spanId>,
+            *  "logs":[{"timestamp":<micros>,"fields":{<key>:<value>,...}},...],"span":<span line>}
+            */
+            out.append("{\"customer\":\"default\",\"traceId\":\"", 33);
+            appendUuid(out, traceId);
+            out.append("\",\"spanId\":\"", 12);
+            appendUuid(out, spanId);
+            out.append("\",\"logs\":[", 10);
+            bool firstLog = true;
+            for (auto &spanLog : spanLogs) {
+                if (!firstLog) {
+                    out.push_back(',');
+                }
+                firstLog = false;
+                out.append("{\"timestamp\":", 13);
+                appendLong(out, spanLog.timestampMicros);
+                out.append(",\"fields\":{", 11);
+                bool firstField = true;
+                for (auto &field : spanLog.fields) {
+                    if (!firstField) {
+                        out.push_back(',');
+                    }
+                    firstField = false;
+                    appendJsonString(out, field.first);
+                    out.push_back(':');
+                    appendJsonString(out, field.second);
                 }
+                out.append("}}", 2);
             }
-            appendTagMap(ss, tags);
-            ss << " " << startMillis << " " << durationMillis;
-            ss << "\n";
+            out.append("],\"span\":", 9);
+            appendJsonString(out, span, spanLength);
+            out.append("}\n", 2);
+        }
 
-            // TODO: support span log
-            return ss.str();
+        static std::string
+        metricsToLineData(const std::string &name, double value, long timestamp, const std::string &source,
+                          std::map<std::string, std::string> tags) {
+            OutputBuffer out;
+            appendMetric(out, name, value, timestamp, source, tags);
+            return out.str();
         }
 
+        static std::string
+        histogramToLineData(const std::string &name, std::list<std::pair<double, int>> centroids,
+                            std::set<wavefront::HistogramGranularity> histogramGranularities, long timestamp,
+                            const std::string &source, std::map<std::string, std::string> tags) {
+            OutputBuffer out;
+            appendHistogram(out, name, centroids, histogramGranularities, timestamp, source, tags);
+            return out.str();
+        }
 
+        static std::string spanToLineData(const std::string &name, long startMillis, long durationMillis,
+                                   boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                                   std::list<boost::uuids::uuid> parents, std::list<boost::uuids::uuid> followsFrom,
+                                   std::map<std::string, std::string> tags){
+            OutputBuffer out;
+            appendSpan(out, name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags);
+            return out.str();
+        }
     };
 }
\ No newline at end of file
@@ -3,8 +3,21 @@
 #include "SocketException.h"
 #include <netinet/in.h>      // For sockaddr_in
 #include <sys/socket.h>      // For socket(), connect(), send(), and recv()
+#include <sys/uio.h>         // For iovec
 
 namespace wavefront {
+    /**
+    *   TCP tuning applied to a socket once it is connected
+    */
+    struct SocketOptions {
+        // disable Nagle's algorithm so small writes are not held back waiting for an ACK
+        bool tcpNoDelay = false;
+        // kernel send buffer size in bytes, 0 keeps the system default
+        int sendBufferSize = 0;
+        // hold partial frames while a batch of buffered lines is written (TCP_CORK, Linux only)
+        bool cork = false;
+    };
+
     /**
     *   Base class representing basic communication endpoint
     *   @author Mengran Wang (mengranw@vmware.com)
@@ -64,6 +77,13 @@ namespace wavefront {
         */
         void close() throw(SocketException);
 
+        /**
+         *   @return the underlying socket descriptor, -1 once closed
+         */
+        int getDescriptor() const {
+            return sockDesc;
+        }
+
     private:
         // Prevent the user from trying to use value semantics on this object
         Socket(const Socket &sock);
@@ -104,9 +124,68 @@ namespace wavefront {
          */
         void send(const char *buffer, int bufferLen) throw(SocketException);
 
+        /**
+         *   Write the given buffers to this socket as one gather write, resuming
+         *   after short writes until every byte is written.  Call connect() before
+         *   calling sendv()
+         *   @param buffers buffers to be written, advanced in place as data is written
+         *   @param count number of buffers
+         *   @exception SocketException thrown if unable to send data
+         */
+        void sendv(iovec *buffers, int count) throw(SocketException);
+
+        /**
+         *   Switch the socket between blocking and non-blocking mode
+         *   @exception SocketException thrown if the mode cannot be changed
+         */
+        void setNonBlocking(bool nonBlocking) throw(SocketException);
+
+        /**
+         *   Start connecting a non-blocking socket to the given foreign address and port.
+         *   When the connection is still in progress, wait for the socket to become
+         *   writable and call finishConnect()
+         *   @return true if the connection was established immediately
+         *   @exception SocketException thrown if the connection attempt fails
+         */
+        bool connectNonBlocking(const std::string &foreignAddress, unsigned short foreignPort)
+        throw(SocketException);
+
+        /**
+         *   Complete a connection started by connectNonBlocking()
+         *   @exception SocketException thrown if the connection could not be established
+         */
+        void finishConnect() throw(SocketException);
+
+        /**
+         *   Write as much of the given buffers as a non-blocking socket accepts
+         *   @param buffers buffers to be written, advanced in place as data is written
+         *   @param count number of buffers
+         *   @return number of leading buffers written completely; less than count when
+         *   the socket buffer is full
+         *   @exception SocketException thrown if unable to send data
+         */
+        int trySendv(iovec *buffers, int count) throw(SocketException);
+
+        /**
+         *   Apply TCP_NODELAY and SO_SNDBUF from the given options
+         *   @exception SocketException thrown if an option cannot be set
+         */
+        void applyOptions(const SocketOptions &options) throw(SocketException);
+
+        /**
+         *   Cork or uncork the connection; uncorking pushes out any partial frame.
+         *   Has no effect where TCP_CORK is not available
+         *   @exception SocketException thrown if the option cannot be set
+         */
+        void setCork(bool cork) throw(SocketException);
+
 
     protected:
         CommunicatingSocket(int newConnSD);
+
+    private:
+        // write until every buffer is consumed, or until the socket would block when nonBlocking is set
+        int writeBuffers(iovec *buffers, int count, bool nonBlocking) throw(SocketException);
     };
 }
 
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace wavefront {
+    /**
+    * Timestamped key/value record attached to a span, e.g. an event or an error logged while the span was active.
+    */
+    struct SpanLog {
+        SpanLog(long timestampMicros, const std::map<std::string, std::string> &fields)
+                : timestampMicros(timestampMicros), fields(fields) {
+        }
+
+        // microseconds since the epoch
+        long timestampMicros;
+        std::map<std::string, std::string> fields;
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <boost/uuid/uuid.hpp>
+#include "SpanLog.h"
+#include "TagSet.h"
+
+namespace wavefront {
+    /**
+    * A span of a batch handed to WavefrontSender::sendSpans. The fields have the meaning of the parameters of
+    * WavefrontSender::sendSpan.
+    */
+    struct SpanPoint {
+        std::string name;
+        long startMillis = 0;
+        long durationMillis = 0;
+        boost::uuids::uuid traceId;
+        boost::uuids::uuid spanId;
+        std::string source;
+        std::list<boost::uuids::uuid> parents;
+        std::list<boost::uuids::uuid> followsFrom;
+        std::map<std::string, std::string> tags;
+        // tags serialized ahead of time, sent instead of tags when set, see TagSet::intern
+        std::shared_ptr<const TagSet> tagSet;
+        std::list<SpanLog> spanLogs;
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace wavefront {
+    /**
+    * Immutable set of point tags that is escaped and serialized once, when it is created.
+    *
+    * Sending a point with a TagSet copies its pre-serialized bytes instead of escaping every key and value
+    * again. Obtain instances through intern(), which hands out the same instance for identical tag maps
+    * for as long as any handle to it is alive.
+    */
+    class TagSet {
+    public:
+        typedef std::map<std::string, std::string> TagMap;
+
+        /**
+         * Return the shared TagSet for tags, creating it on first use.
+         * Safe to call from multiple threads.
+         */
+        static std::shared_ptr<const TagSet> intern(const TagMap &tags);
+
+        // Build a TagSet that is not shared through the intern table
+        static std::shared_ptr<const TagSet> create(const TagMap &tags);
+
+        inline const TagMap &getTags() const {
+            return tags;
+        }
+
+        // the tags as written on the wire: ' "key"="value"' for every tag, in key order
+        inline const std::string &getSerialized() const {
+            return serialized;
+        }
+
+        inline bool empty() const {
+            return tags.empty();
+        }
+
+    private:
+        struct Token {
+        };
+
+        TagSet(const TagMap &tags, std::string serialized, Token);
+
+        TagSet(const TagSet &);
+
+        TagSet &operator=(const TagSet &);
+
+        static std::string serialize(const TagMap &tags);
+
+        const TagMap tags;
+        const std::string serialized;
+    };
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <chrono>
+#include <string>
+#include <boost/algorithm/string/predicate.hpp>
+#include "Constants.h"
 
 namespace wavefront {
     namespace Utils {
@@ -24,6 +27,14 @@ namespace wavefront {
             int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
             return seconds;
         }
+
+        // prefix a delta counter name with ∆ unless it starts with ∆ or Δ already
+        inline void add_delta_prefix(std::string &name) {
+            if (!boost::starts_with(name, constant::DELTA_PREFIX) &&
+                !boost::starts_with(name, constant::DELTA_PREFIX_2)) {
+                name.insert(0, constant::DELTA_PREFIX);
+            }
+        }
     }
 }
 
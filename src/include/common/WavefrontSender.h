@@ -4,8 +4,15 @@
 #include <string>
 #include <list>
 #include <set>
+#include <vector>
 #include <boost/uuid/uuid.hpp>
+#include "ArrayView.h"
 #include "HistogramGranularity.h"
+#include "MetricPoint.h"
+#include "MetricSeries.h"
+#include "SpanLog.h"
+#include "SpanPoint.h"
+#include "TagSet.h"
 
 namespace wavefront {
     /**
@@ -35,6 +42,64 @@ namespace wavefront {
         sendMetric(const std::string &name, double value, long timestamp = -1, const std::string &source = "",
                    std::map<std::string, std::string> tags = {{}}) = 0;
 
+        /**
+         * Sends the given metric to Wavefront, with tags that were serialized ahead of time.
+         *
+         * @param name      The name of the metric.
+         * @param value     The value to be sent.
+         * @param timestamp The timestamp in milliseconds since the epoch, or -1 to let Wavefront assign it.
+         * @param source    The source (or host) that's sending the metric. If empty then assigned by
+         *                  Wavefront.
+         * @param tags      The tags associated with this metric, see TagSet::intern. Senders copy the
+         *                  serialized tags; the default implementation calls the overload taking a tag map.
+         */
+        virtual void
+        sendMetric(const std::string &name, double value, long timestamp, const std::string &source,
+                   const TagSet &tags) {
+            sendMetric(name, value, timestamp, source, tags.getTags());
+        }
+
+        /**
+         * Sends the given metric to Wavefront, reading the name, source and tags in place. Senders serialize
+         * them without copying; the default implementation copies them and calls the overload taking a tag map.
+         * See that overload for the meaning of the parameters.
+         *
+         * @param tags      The tags associated with this metric, borrowed for the duration of the call.
+         */
+        virtual void
+        sendMetric(boost::string_view name, double value, long timestamp, boost::string_view source,
+                   ArrayView<TagView> tags) {
+            sendMetric(std::string(name), value, timestamp, std::string(source), toTagMap(tags));
+        }
+
+        /**
+         * Registers a metric series whose name, source and tags are serialized once, for sending points
+         * with sendMetric(const MetricSeries &, double, long).
+         *
+         * @param name      The name of the metric. Quotes will be automatically escaped.
+         * @param source    The source (or host) of the series. If empty then the sender's default source is used.
+         * @param tags      The tags associated with this series.
+         * @return a handle that stays valid independently of this sender
+         * @throws std::invalid_argument if name is empty
+         */
+        virtual std::shared_ptr<const MetricSeries>
+        registerSeries(const std::string &name, const std::string &source = "",
+                       const std::map<std::string, std::string> &tags = {}) {
+            return MetricSeries::create(name, source, tags);
+        }
+
+        /**
+         * Sends a point of a series returned by registerSeries to Wavefront. The default implementation calls
+         * the overload taking a TagSet with the series' name, source and tags.
+         *
+         * @param series    The registered series.
+         * @param value     The value to be sent.
+         * @param timestamp The timestamp in milliseconds since the epoch, or -1 to let Wavefront assign it.
+         */
+        virtual void sendMetric(const MetricSeries &series, double value, long timestamp = -1) {
+            sendMetric(series.getName(), value, timestamp, series.getSource(), *series.getTags());
+        }
+
         /**
         * Sends the given histogram to Wavefront
         * @param name                       The name of the histogram distribution. Spaces are replaced
@@ -57,6 +122,31 @@ namespace wavefront {
                                       const std::string &source = "",
                                       std::map<std::string, std::string> tags = {{}}) = 0;
 
+        /**
+        * Sends the given histogram to Wavefront, with tags that were serialized ahead of time.
+        * See the overload taking a tag map for the meaning of the other parameters.
+        *
+        * @param tags                       The tags associated with this histogram, see TagSet::intern.
+        */
+        virtual void sendDistribution(const std::string &name, const std::list<std::pair<double, int>> &centroids,
+                                      const std::set<HistogramGranularity> &histogramGranularities, long timestamp,
+                                      const std::string &source, const TagSet &tags) {
+            sendDistribution(name, centroids, histogramGranularities, timestamp, source, tags.getTags());
+        }
+
+        /**
+        * Sends the given histogram to Wavefront, reading its arguments in place. See sendMetric taking
+        * ArrayView<TagView> and the overload taking containers.
+        */
+        virtual void sendDistribution(boost::string_view name, ArrayView<std::pair<double, int>> centroids,
+                                      ArrayView<HistogramGranularity> histogramGranularities, long timestamp,
+                                      boost::string_view source, ArrayView<TagView> tags) {
+            sendDistribution(std::string(name), std::list<std::pair<double, int>>(centroids.begin(), centroids.end()),
+                             std::set<HistogramGranularity>(histogramGranularities.begin(),
+                                                            histogramGranularities.end()),
+                             timestamp, std::string(source), toTagMap(tags));
+        }
+
         /**
          * Send a trace span to Wavefront.
          *
@@ -77,6 +167,96 @@ namespace wavefront {
                               std::list<boost::uuids::uuid> followsFrom = {},
                               std::map<std::string, std::string> tags = {{}}) = 0;
 
+        /**
+         * Send a trace span to Wavefront, with span tags that were serialized ahead of time.
+         * See the overload taking a tag map for the meaning of the other parameters.
+         *
+         * @param tags                The span tags associated with this span, see TagSet::intern.
+         */
+        virtual void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                              boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                              const std::list<boost::uuids::uuid> &parents,
+                              const std::list<boost::uuids::uuid> &followsFrom, const TagSet &tags) {
+            sendSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom,
+                     tags.getTags());
+        }
+
+        /**
+         * Send a trace span to Wavefront, reading its arguments in place. See sendMetric taking
+         * ArrayView<TagView> and the overload taking containers.
+         */
+        virtual void sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                              const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                              boost::string_view source, ArrayView<boost::uuids::uuid> parents,
+                              ArrayView<boost::uuids::uuid> followsFrom, ArrayView<TagView> tags) {
+            sendSpan(std::string(name), startMillis, durationMillis, traceId, spanId, std::string(source),
+                     std::list<boost::uuids::uuid>(parents.begin(), parents.end()),
+                     std::list<boost::uuids::uuid>(followsFrom.begin(), followsFrom.end()), toTagMap(tags));
+        }
+
+        /**
+         * Send a trace span to Wavefront together with its span logs. The span is tagged _spanLogs=true and the
+         * logs are sent as a separate span logs record that refers to it.
+         * See the overload without span logs for the meaning of the other parameters.
+         *
+         * @param spanLogs            The span logs of this span; without any, only the span is sent. The default
+         *                            implementation sends only the span.
+         */
+        virtual void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                              boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                              const std::list<boost::uuids::uuid> &parents,
+                              const std::list<boost::uuids::uuid> &followsFrom,
+                              const std::map<std::string, std::string> &tags,
+                              const std::list<SpanLog> &/*spanLogs*/) {
+            sendSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags);
+        }
+
+        /**
+         * Send a trace span to Wavefront together with its span logs, with span tags that were serialized ahead
+         * of time. See the overload taking a tag map.
+         */
+        virtual void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                              boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                              const std::list<boost::uuids::uuid> &parents,
+                              const std::list<boost::uuids::uuid> &followsFrom, const TagSet &tags,
+                              const std::list<SpanLog> &/*spanLogs*/) {
+            sendSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags);
+        }
+
+        /**
+         * Sends a batch of metrics to Wavefront. Senders serialize the batch into a few large buffers and hand
+         * those on at once, which is much cheaper than a call per point. The default implementation calls
+         * sendMetric for every point.
+         *
+         * @param metrics   The points to be sent; invalid points are counted as failures and skipped.
+         */
+        virtual void sendMetrics(const std::vector<MetricPoint> &metrics) {
+            for (auto &metric : metrics) {
+                if (metric.tagSet != nullptr) {
+                    sendMetric(metric.name, metric.value, metric.timestamp, metric.source, *metric.tagSet);
+                } else {
+                    sendMetric(metric.name, metric.value, metric.timestamp, metric.source, metric.tags);
+                }
+            }
+        }
+
+        /**
+         * Sends a batch of trace spans, with their span logs, to Wavefront. See sendMetrics.
+         *
+         * @param spans     The spans to be sent; invalid spans are counted as failures and skipped.
+         */
+        virtual void sendSpans(const std::vector<SpanPoint> &spans) {
+            for (auto &span : spans) {
+                if (span.tagSet != nullptr) {
+                    sendSpan(span.name, span.startMillis, span.durationMillis, span.traceId, span.spanId,
+                             span.source, span.parents, span.followsFrom, *span.tagSet, span.spanLogs);
+                } else {
+                    sendSpan(span.name, span.startMillis, span.durationMillis, span.traceId, span.spanId,
+                             span.source, span.parents, span.followsFrom, span.tags, span.spanLogs);
+                }
+            }
+        }
+
         /**
         * Sends the given delta counter to Wavefront. The timestamp for the point on the client side is
         * null because the final timestamp of the delta counter is assigned when the point is
@@ -96,6 +276,17 @@ namespace wavefront {
         virtual void sendDeltaCounter(std::string &name, double value, const std::string &source,
                                       std::map<std::string, std::string> tags = {{}}) = 0;
 
+        /**
+        * Sends the given delta counter to Wavefront, with tags that were serialized ahead of time.
+        * See the overload taking a tag map for the meaning of the other parameters.
+        *
+        * @param tags      The tags associated with this metric, see TagSet::intern.
+        */
+        virtual void sendDeltaCounter(std::string &name, double value, const std::string &source,
+                                      const TagSet &tags) {
+            sendDeltaCounter(name, value, source, tags.getTags());
+        }
+
         /**
         * Closes this stream and releases any system resources associated
         * with it. If the stream is already closed then invoking this
@@ -104,5 +295,14 @@ namespace wavefront {
         virtual void close() = 0;
 
         virtual int getFailureCount() = 0;
+
+    protected:
+        static std::map<std::string, std::string> toTagMap(ArrayView<TagView> tags) {
+            std::map<std::string, std::string> tagMap;
+            for (auto &tag : tags) {
+                tagMap.emplace(std::string(tag.first), std::string(tag.second));
+            }
+            return tagMap;
+        }
     };
 }
\ No newline at end of file
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <cpr/cpr.h>
 
 namespace wavefront {
     /**
     *  DataIngester service that reports entities to Wavefront
     *
+    *  Sessions are pooled and reused across reports and data formats, so consecutive flushes share a kept-alive
+    *  connection instead of connecting (and handshaking) every time. Sessions idle for longer than the idle
+    *  timeout, or that failed at the transport level, are discarded and replaced by new connections.
+    *
     *  @author Mengran Wang (mengranw@vmware.com)
     */
     class DirectIngesterService {
     public:
-        DirectIngesterService(std::string url, std::string token);
+        /**
+        * @param compressionLevel gzip level from 1 (fastest) to 9 (smallest), -1 for the zlib default
+        * @param idleTimeoutSeconds how long an unused connection is kept for reuse, 0 disables reuse
+        */
+        DirectIngesterService(std::string url, std::string token, int compressionLevel = -1,
+                              int idleTimeoutSeconds = 30);
 
         /**
         * The API for reporting points directly to a Wavefront server.
@@ -22,10 +35,40 @@ namespace wavefront {
         */
         cpr::Response report(std::string format, std::list<std::string> targets);
 
+        /**
+        * Report a payload that is already gzip compressed, e.g. by a GzipCompressor.
+        *
+        * @param format wavefront supported format see @constant.cpp
+        * @param payload gzip compressed line data
+        * @param length size of the payload in bytes
+        */
+        cpr::Response reportCompressed(const std::string &format, const char *payload, size_t length);
+
+        inline int getCompressionLevel() const {
+            return compressionLevel;
+        }
+
     private:
         std::string getCompressedString(const std::list<std::string> &targets);
 
+        cpr::Response post(const std::string &format, cpr::Body &&body);
+
+        struct PooledSession {
+            cpr::Session session;
+            std::chrono::steady_clock::time_point lastUsed;
+        };
+
+        // take an idle session that has not timed out, or create a new one
+        std::unique_ptr<PooledSession> acquireSession();
+
+        void releaseSession(std::unique_ptr<PooledSession> session);
+
         std::string uri;
         std::string token;
+        int compressionLevel;
+        int idleTimeoutSeconds;
+
+        std::mutex sessionMutex;
+        std::vector<std::unique_ptr<PooledSession>> idleSessions;
     };
 }
\ No newline at end of file
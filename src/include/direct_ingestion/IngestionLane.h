@@ -0,0 +1,240 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/BoundedQueue.h"
+#include "../common/GzipCompressor.h"
+#include "../common/OutputBuffer.h"
+#include "../common/RetryPolicy.h"
+#include "../metrics/SdkMetrics.h"
+#include "DirectIngesterService.h"
+#include "LineArena.h"
+#include "SpillQueue.h"
+
+namespace wavefront {
+    /**
+    * Per data type tuning of a WavefrontDirectIngestionClient lane. Fields left at 0 take the client-wide
+    * setting of the Builder.
+    */
+    struct LaneOptions {
+        // points queued before new points are dropped
+        int maxQueueSize = 0;
+        // bytes of serialized lines queued before new points are dropped
+        size_t maxQueueBytes = 0;
+        // points per report
+        int batchSize = 0;
+        // uncompressed bytes per report; a report is cut at batchSize points or batchBytes, whichever comes first
+        size_t batchBytes = 0;
+        // how often a partial batch is reported
+        int flushIntervalSeconds = 0;
+        // reports of this lane that may be in flight at the same time
+        int maxInFlight = 0;
+    };
+
+    // memory held by a lane, see IngestionLane::getGauges()
+    struct LaneGauges {
+        size_t queuedPoints = 0;
+        // serialized lines in the queue
+        size_t queuedBytes = 0;
+        // arena slabs holding the queued lines, in use or kept for reuse
+        size_t arenaBytes = 0;
+        // compressed payloads waiting in the spill directory
+        size_t spilledBytes = 0;
+    };
+
+    /**
+    * Queue and flush pipeline of one data format. Each lane owns a bounded queue and maxInFlight flush threads
+    * that drain it independently, so a slow upload of one data type never delays another and a busy lane keeps
+    * several reports in flight. The flush threads sleep on a condition variable: enqueue wakes one as soon as a
+    * batch is ready, otherwise they wake when the flush interval expires or the lane is stopped.
+    *
+    * Queued lines are copied into a LineArena rather than allocated one by one, and a flush thread compresses
+    * runs of lines that are adjacent in it with a single write.
+    *
+    * A flush thread keeps the compressed payload of a failed report and retries it on the RetryPolicy's
+    * backoff before it reports anything newer. Payloads rejected with a client error are dropped right away.
+    *
+    * With a SpillQueue, batches that fail to report are compressed and paged to disk instead of going back to
+    * the queue, and a drainer thread replays them once the endpoint recovers. While anything is spilled, new
+    * batches are spilled behind it so that points are reported in order.
+    */
+    class IngestionLane {
+    public:
+        /**
+        * @param name data type named in log messages, e.g. "metrics"
+        * @param format wavefront supported format see @constant.cpp
+        * @param options resolved lane options, no field may be 0
+        * @param metrics where queued, dropped and reported points are counted, shared by the lanes of a client
+        * @param streamingCompression compress queued points between flushes, see GzipCompressor
+        * @param spill where failed batches are kept until they can be reported, nullptr to keep them queued
+        */
+        IngestionLane(const std::string &name, const std::string &format, const LaneOptions &options,
+                      DirectIngesterService &service, RetryPolicy &retryPolicy, SdkMetrics &metrics,
+                      bool streamingCompression, int compressionLevel,
+                      std::unique_ptr<SpillQueue> spill = nullptr);
+
+        ~IngestionLane();
+
+        // copy serialized line data of one point into the queue, dropping it if the queue is full
+        bool enqueue(const OutputBuffer &lineData);
+
+        /**
+        * Copy the lines of several points into the queue as one entry, dropping them all if the queue can't take
+        * them. A batch is reported with as many entries as fit into batchSize points and batchBytes, plus at most
+        * one entry more.
+        */
+        bool enqueue(const OutputBuffer &lineData, int points);
+
+        void start();
+
+        /**
+        * Have the flush threads report everything queued and exit. Whatever is still queued at the deadline is
+        * spilled, or dropped without a SpillQueue. Without running flush threads the queue is drained by the
+        * calling thread.
+        */
+        void stop(std::chrono::steady_clock::time_point deadline);
+
+        // wait for the flush threads to finish draining
+        void join();
+
+        inline int getFailureCount() {
+            return failures.load();
+        }
+
+        inline const std::string &getName() const {
+            return name;
+        }
+
+        // snapshot of the memory the lane holds, while points are sent and flushed concurrently
+        LaneGauges getGauges();
+
+    private:
+        // gzip stream of the next report: fed between flushes in streaming mode, all at once otherwise
+        struct CompressedBatch {
+            CompressedBatch(int compressionLevel) : compressor(compressionLevel) {
+            }
+
+            GzipCompressor compressor;
+            int points = 0;
+            // uncompressed bytes, including lines not yet written to the compressor
+            size_t bytes = 0;
+            // spent in the compressor so far
+            std::chrono::nanoseconds compressionTime{0};
+
+            inline bool full(int batchSize, size_t batchBytes) const {
+                return points >= batchSize || bytes >= batchBytes;
+            }
+        };
+
+        // a failed payload waiting for its next attempt
+        struct PendingRetry {
+            OutputBuffer payload;
+            int points = 0;
+            int attempts = 0;
+            std::chrono::steady_clock::time_point retryAt;
+        };
+
+        // serialized lines of one or more points, held in the arena until they are compressed or spilled
+        struct QueuedLines {
+            LineArena::Block block;
+            int points = 0;
+        };
+
+        struct Worker {
+            std::unique_ptr<CompressedBatch> batch;
+            PendingRetry retry;
+            std::thread thread;
+        };
+
+        void run(Worker &worker);
+
+        // report what is pending and queued until the deadline passes, then spill or drop the rest
+        void drain(Worker &worker, std::chrono::steady_clock::time_point deadline);
+
+        // retry the pending payload if its backoff has passed; false while it is still pending
+        bool resolveRetry(Worker &worker);
+
+        // report or spill up to one batch of queued points; false if the queue was empty or the report failed
+        bool reportQueued(Worker &worker);
+
+        // compress queued points into the batch, reporting it whenever it is full
+        void compressQueued(Worker &worker);
+
+        // report or spill the batch; false if it failed and is now pending retry, or another retry is pending
+        bool reportBatch(Worker &worker);
+
+        RetryPolicy::Outcome reportPayload(const char *payload, size_t length, int points);
+
+        // replay spilled payloads in order, backing off while the endpoint is unavailable
+        void replaySpill();
+
+        void spillPayload(const char *payload, size_t length, int points);
+
+        // compress and spill queued lines, releasing them from the arena
+        void spillLines(const std::list<QueuedLines> &lines);
+
+        // a full batch is queued
+        inline bool batchQueued() const {
+            return queuedPoints.load() >= static_cast<size_t>(batchSize) || queuedBytes.load() >= batchBytes;
+        }
+
+        // pop the oldest entry, keeping queuedPoints and queuedBytes in step
+        bool pop(QueuedLines &lines);
+
+        /**
+        * Add popped lines to the run of lines to compress, which grows while the lines follow each other in the
+        * same slab. Otherwise the run is written first and the lines start a new one.
+        */
+        void appendRun(CompressedBatch &batch, LineArena::Block &run, const LineArena::Block &lines);
+
+        // compress the run and release its slab
+        void writeRun(CompressedBatch &batch, LineArena::Block &run);
+
+        // spill what a worker could not report before the deadline, or drop it without a SpillQueue
+        void discard(OutputBuffer &payload, int points);
+
+        std::string name;
+        std::string format;
+        int batchSize;
+        size_t batchBytes;
+        int flushIntervalSeconds;
+        bool streamingCompression;
+        int compressionLevel;
+        // queued points or bytes that wake a flush thread: a full batch, or a slice of one to compress in streaming
+        // mode
+        size_t wakeThreshold;
+        size_t wakeBytes;
+
+        LineArena arena;
+        // lock-free, bounded by maxQueueSize; any thread may send while the flush threads drain
+        BoundedQueue<QueuedLines> queue;
+        // points in the queue, which holds fewer entries than points once batches are enqueued
+        std::atomic<size_t> queuedPoints;
+        size_t maxQueuedPoints;
+        std::atomic<size_t> queuedBytes;
+        size_t maxQueuedBytes;
+        DirectIngesterService &service;
+        RetryPolicy &retryPolicy;
+        SdkMetrics &metrics;
+        std::vector<Worker> workers;
+        std::atomic<int> failures;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::atomic<bool> wakeRequested;
+        std::atomic<bool> is_running;
+        std::atomic<bool> stopping;
+        std::chrono::steady_clock::time_point stopDeadline;
+
+        std::unique_ptr<SpillQueue> spill;
+        std::thread spillDrainer;
+        std::condition_variable spillCondition;
+    };
+}
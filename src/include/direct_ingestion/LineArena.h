@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wavefront {
+    /**
+    * Storage of the serialized lines waiting in an IngestionLane. Lines are copied back to back into large slabs
+    * instead of one heap allocation each, so the lines queued by one core sit next to each other and a flush
+    * thread can compress a run of them with a single write.
+    *
+    * Each core appends to its own current slab under a per-stripe lock. A slab counts the blocks handed out of
+    * it plus one reference while it is current; once the last of them is released it goes back to a free list,
+    * so a lane in steady state allocates no memory at all. Lines larger than a slab get a slab of their own that
+    * is freed with them.
+    */
+    class LineArena {
+    public:
+        struct Slab;
+
+        // lines copied into a slab; the slab is held until the block is released
+        struct Block {
+            const char *data = nullptr;
+            size_t length = 0;
+            Slab *slab = nullptr;
+        };
+
+        /**
+        * @param slabSize bytes per slab
+        * @param maxFreeSlabs slabs kept for reuse once released, further ones are freed
+        */
+        explicit LineArena(size_t slabSize = DEFAULT_SLAB_SIZE, size_t maxFreeSlabs = DEFAULT_MAX_FREE_SLABS);
+
+        // every block must have been released
+        ~LineArena();
+
+        // copy length bytes into the arena
+        Block copy(const char *data, size_t length);
+
+        void release(const Block &block);
+
+        // true if b directly follows a in the same slab, so that both can be read as one run
+        static inline bool adjacent(const Block &a, const Block &b) {
+            return a.slab == b.slab && a.data + a.length == b.data;
+        }
+
+        // bytes of all slabs, in use or free
+        inline size_t getAllocatedBytes() const {
+            return allocatedBytes.load(std::memory_order_relaxed);
+        }
+
+        const static size_t DEFAULT_SLAB_SIZE = 256 * 1024;
+        const static size_t DEFAULT_MAX_FREE_SLABS = 8;
+
+    private:
+        LineArena(const LineArena &);
+
+        LineArena &operator=(const LineArena &);
+
+        const static size_t CACHE_LINE_SIZE = 64;
+
+        struct Stripe {
+            std::mutex mutex;
+            Slab *current = nullptr;
+            char padding[CACHE_LINE_SIZE];
+        };
+
+        // a slab with a single reference, from the free list if one is available
+        Slab *acquire(size_t capacity);
+
+        // drop a reference, recycling the slab once there are none left
+        void unreference(Slab *slab);
+
+        const size_t slabSize;
+        const size_t maxFreeSlabs;
+        size_t stripeCount;
+        std::unique_ptr<Stripe[]> stripes;
+        std::mutex freeMutex;
+        std::vector<Slab *> freeSlabs;
+        std::atomic<size_t> allocatedBytes;
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace wavefront {
+    /**
+    * Disk-backed FIFO of compressed report payloads, kept in append-only memory-mapped segment files.
+    *
+    * Payloads are appended to the newest segment and consumed from the oldest one; a segment file is deleted
+    * once everything in it has been consumed. Consumed records are marked in place, so segments left behind by
+    * a previous process are picked up again on construction and only their pending payloads are replayed.
+    * Total segment size is bounded by maxBytes.
+    */
+    class SpillQueue {
+    public:
+        /**
+        * @param directory where segment files are kept, created if missing
+        * @param maxBytes upper bound of the total size of all segment files
+        * @throws std::runtime_error if the directory or an existing segment can't be used
+        */
+        SpillQueue(const std::string &directory, size_t maxBytes);
+
+        ~SpillQueue();
+
+        /**
+        * Append a compressed payload of the given number of points.
+        *
+        * @return false if the payload would exceed maxBytes or could not be written
+        */
+        bool append(const char *payload, size_t length, int points);
+
+        /**
+        * Oldest pending payload. The data stays valid until pop() is called.
+        *
+        * @return false if nothing is pending
+        */
+        bool peek(const char *&payload, size_t &length, int &points);
+
+        // mark the payload returned by peek() as consumed
+        void pop();
+
+        bool empty();
+
+        // compressed bytes pending
+        size_t getPendingBytes();
+
+    private:
+        struct Segment;
+
+        SpillQueue(const SpillQueue &);
+
+        SpillQueue &operator=(const SpillQueue &);
+
+        void load();
+
+        // map an existing segment file and find its pending records
+        std::unique_ptr<Segment> openSegment(const std::string &path, uint64_t sequence);
+
+        std::unique_ptr<Segment> createSegment(size_t capacity);
+
+        // move the read position of the front segment past consumed records, deleting it when exhausted
+        void advance();
+
+        void release(Segment &segment, bool remove);
+
+        std::string segmentPath(uint64_t sequence);
+
+        std::string directory;
+        size_t maxBytes;
+        size_t fileBytes = 0;
+        size_t pendingBytes = 0;
+        uint64_t nextSequence = 0;
+
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Segment>> segments;
+    };
+}
@@ -1,12 +1,21 @@
 #pragma once
 
-#include <queue>
+#include <atomic>
+#include <map>
+#include <memory>
 #include "../common/WavefrontSender.h"
+#include "../common/GzipCompressor.h"
+#include "../common/OutputBuffer.h"
+#include "../metrics/MetricRegistry.h"
+#include "../metrics/SdkMetrics.h"
+#include "../sampling/Sampler.h"
 #include "DirectIngesterService.h"
+#include "IngestionLane.h"
 
 namespace wavefront {
     /**
     *  Wavefront direct ingestion client that sends data directly to Wavefront cluster via the direct ingestion API.
+    *  Metrics, histograms, spans and span logs are queued and reported by independent lanes, see IngestionLane.
     *
     *  @author Mengran Wang (mengranw@vmware.com)
     */
@@ -17,21 +26,121 @@ namespace wavefront {
             Builder(const std::string &serverName, const std::string &token) : serverName(serverName), token(token) {
             }
 
-            Builder setMaxQueueSize(int maxQueueSize) {
+            Builder &setMaxQueueSize(int maxQueueSize) {
                 this->maxQueueSize = maxQueueSize;
                 return *this;
             }
 
-            Builder setFlushingInterval(int flushIntervalSeconds) {
+            Builder &setFlushingInterval(int flushIntervalSeconds) {
                 this->flushIntervalSeconds = flushIntervalSeconds;
                 return *this;
             }
 
-            Builder setBatchSize(int batchSize) {
+            Builder &setBatchSize(int batchSize) {
                 this->batchSize = batchSize;
                 return *this;
             }
 
+            // memory each lane may hold in queued lines before new points are dropped, 0 for no limit
+            Builder &setMaxQueueBytes(size_t maxQueueBytes) {
+                this->maxQueueBytes = maxQueueBytes;
+                return *this;
+            }
+
+            // uncompressed size at which a report is cut before it reaches batchSize points, 0 for no limit
+            Builder &setBatchBytes(size_t batchBytes) {
+                this->batchBytes = batchBytes;
+                return *this;
+            }
+
+            // how long close() may take to report what is still queued, the rest is dropped
+            Builder &setCloseTimeout(int closeTimeoutSeconds) {
+                this->closeTimeoutSeconds = closeTimeoutSeconds;
+                return *this;
+            }
+
+            // reports per lane that may be in flight at the same time
+            Builder &setMaxInFlightRequests(int maxInFlight) {
+                this->maxInFlight = maxInFlight;
+                return *this;
+            }
+
+            // settings of the metrics lane that differ from the client-wide ones
+            Builder &setMetricsLane(const LaneOptions &metricsLane) {
+                this->metricsLane = metricsLane;
+                return *this;
+            }
+
+            Builder &setHistogramLane(const LaneOptions &histogramLane) {
+                this->histogramLane = histogramLane;
+                return *this;
+            }
+
+            Builder &setTracingLane(const LaneOptions &tracingLane) {
+                this->tracingLane = tracingLane;
+                return *this;
+            }
+
+            // span logs are queued and reported apart from spans, so that large log payloads don't hold spans up
+            Builder &setSpanLogsLane(const LaneOptions &spanLogsLane) {
+                this->spanLogsLane = spanLogsLane;
+                return *this;
+            }
+
+            /**
+             * In streaming mode the flush thread keeps compressing queued points into a gzip stream per data
+             * format between flushes, so a flush only has to finish the stream and send it.
+             */
+            Builder &setStreamingCompression(bool streamingCompression) {
+                this->streamingCompression = streamingCompression;
+                return *this;
+            }
+
+            // gzip level from 1 (fastest) to 9 (smallest), -1 for the zlib default
+            Builder &setCompressionLevel(int compressionLevel) {
+                this->compressionLevel = compressionLevel;
+                return *this;
+            }
+
+            // how long an idle connection to Wavefront is kept for the next flush, 0 connects for every flush
+            Builder &setConnectionIdleTimeout(int idleTimeoutSeconds) {
+                this->idleTimeoutSeconds = idleTimeoutSeconds;
+                return *this;
+            }
+
+            // keep batches that can't be reported under this directory until Wavefront is reachable again
+            Builder &setSpillDirectory(const std::string &spillDirectory) {
+                this->spillDirectory = spillDirectory;
+                return *this;
+            }
+
+            // disk space each lane may spill to before new batches are dropped
+            Builder &setMaxSpillBytes(size_t maxSpillBytes) {
+                this->maxSpillBytes = maxSpillBytes;
+                return *this;
+            }
+
+            // backoff and attempts of failed reports; spilled batches are retried without a bound on the attempts
+            Builder &setRetryOptions(const RetryOptions &retryOptions) {
+                this->retryOptions = retryOptions;
+                return *this;
+            }
+
+            /**
+             * Decide which spans are sent before they are serialized, see Sampler. Without a sampler every span
+             * is sent.
+             */
+            Builder &setSampler(std::shared_ptr<Sampler> sampler) {
+                this->sampler = std::move(sampler);
+                return *this;
+            }
+
+            // report getStats() through the client as ~sdk.cpp.direct_sender.* metrics, 0 to not report them
+            Builder &setSdkMetricsInterval(int sdkMetricsIntervalSeconds) {
+                this->sdkMetricsIntervalSeconds = sdkMetricsIntervalSeconds;
+                return *this;
+            }
+
             WavefrontDirectIngestionClient *build() {
                 return new WavefrontDirectIngestionClient(this);
             }
@@ -43,31 +152,105 @@ namespace wavefront {
             // Optional parameters
             int maxQueueSize = 50000;
             int batchSize = 10000;
+            size_t maxQueueBytes = 64 * 1024 * 1024;
+            size_t batchBytes = 4 * 1024 * 1024;
             int flushIntervalSeconds = 2;
+            int maxInFlight = 2;
+            int closeTimeoutSeconds = 10;
+            LaneOptions metricsLane;
+            LaneOptions histogramLane;
+            LaneOptions tracingLane;
+            LaneOptions spanLogsLane;
+            bool streamingCompression = false;
+            int compressionLevel = Z_DEFAULT_COMPRESSION;
+            int idleTimeoutSeconds = 30;
+            std::string spillDirectory;
+            size_t maxSpillBytes = 1024 * 1024 * 1024;
+            RetryOptions retryOptions;
+            std::shared_ptr<Sampler> sampler;
+            int sdkMetricsIntervalSeconds = 0;
         };
 
         void sendMetric(const std::string &name, double value, long timestamp = -1, const std::string &source = "",
                         std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendMetric(const std::string &name, double value, long timestamp, const std::string &source,
+                        const TagSet &tags) override;
+
+        std::shared_ptr<const MetricSeries>
+        registerSeries(const std::string &name, const std::string &source = "",
+                       const std::map<std::string, std::string> &tags = {}) override;
+
+        void sendMetric(const MetricSeries &series, double value, long timestamp = -1) override;
+
         void sendDeltaCounter(std::string &name, double value, const std::string &source = "",
                               std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendDeltaCounter(std::string &name, double value, const std::string &source,
+                              const TagSet &tags) override;
+
         void sendDistribution(const std::string &name, std::list<std::pair<double, int>> centroids,
                               std::set<HistogramGranularity> histogramGranularities, long timestamp = -1,
                               const std::string &source = "",
                               std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendDistribution(const std::string &name, const std::list<std::pair<double, int>> &centroids,
+                              const std::set<HistogramGranularity> &histogramGranularities, long timestamp,
+                              const std::string &source, const TagSet &tags) override;
+
         void sendSpan(const std::string &name, long startMillis, long durationMillis,
                       boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source = "",
                       std::list<boost::uuids::uuid> parents = {}, std::list<boost::uuids::uuid> followsFrom = {},
                       std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const TagSet &tags) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const std::map<std::string, std::string> &tags, const std::list<SpanLog> &spanLogs) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const TagSet &tags, const std::list<SpanLog> &spanLogs) override;
+
+        void sendMetric(boost::string_view name, double value, long timestamp, boost::string_view source,
+                        ArrayView<TagView> tags) override;
+
+        void sendDistribution(boost::string_view name, ArrayView<std::pair<double, int>> centroids,
+                              ArrayView<HistogramGranularity> histogramGranularities, long timestamp,
+                              boost::string_view source, ArrayView<TagView> tags) override;
+
+        void sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                      const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId, boost::string_view source,
+                      ArrayView<boost::uuids::uuid> parents, ArrayView<boost::uuids::uuid> followsFrom,
+                      ArrayView<TagView> tags) override;
+
+        void sendMetrics(const std::vector<MetricPoint> &metrics) override;
+
+        void sendSpans(const std::vector<SpanPoint> &spans) override;
+
         int getFailureCount() override;
 
+        // memory held by each lane, by lane name: "metrics", "histogram", "span" and "span log"
+        std::map<std::string, LaneGauges> getLaneGauges();
+
+        // points, bytes and latencies of every lane, and the points and bytes they queue
+        SenderStats getStats();
+
+        // retries scheduled and reports given up on or rejected
+        inline const RetryPolicy &getRetryPolicy() const {
+            return retryPolicy;
+        }
+
         void close() override;
 
         /**
-         * start a seperate thread to flush queued content every @flushIntervalSecondsa
+         * start the flushing threads of every lane, which report queued content every @flushIntervalSeconds
          * MUST be called after DirectIngestionClient is constructed
          */
         void start();
@@ -75,27 +258,44 @@ namespace wavefront {
     private:
         WavefrontDirectIngestionClient(Builder *builder);
 
-        void flushTask();
+        // serialize and queue a point; Tags is either a tag map or a TagSet
+        template<typename Tags>
+        void sendMetricLine(boost::string_view name, double value, long timestamp, boost::string_view source,
+                            const Tags &tags);
+
+        // Centroids and Granularities are containers or ArrayViews
+        template<typename Centroids, typename Granularities, typename Tags>
+        void sendDistributionLine(boost::string_view name, const Centroids &centroids,
+                                  const Granularities &histogramGranularities, long timestamp,
+                                  boost::string_view source, const Tags &tags);
+
+        // Ids are lists or ArrayViews of UUIDs
+        template<typename Ids, typename Tags>
+        void sendSpanLine(boost::string_view name, long startMillis, long durationMillis,
+                          const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                          boost::string_view source, const Ids &parents, const Ids &followsFrom, const Tags &tags,
+                          const std::list<SpanLog> &spanLogs);
 
-        void flush();
+        // lane options with the unset fields taken from the builder
+        static LaneOptions resolve(const LaneOptions &options, const Builder *builder);
 
-        void internalFlush(std::queue<std::string> &buffer, const std::string &format);
+        // spill queue of the named lane, nullptr if spilling is disabled or the directory can't be used
+        static std::unique_ptr<SpillQueue> createSpill(const std::string &lane, const Builder *builder);
 
         // source is hardcoded
         std::string defaultSource = "wavefrontDirectSender";
-        int batchSize;
-        int maxQueueSize;
-        int flushIntervalSeconds;
-
-        std::mutex mutex;
-        std::queue<std::string> metricsBuffer;
-        std::queue<std::string> histogramBuffer;
-        std::queue<std::string> tracingBuffer;
         std::atomic<int> failures;
+        int closeTimeoutSeconds;
 
         DirectIngesterService service;
-        // thread dedicated for flushing task
-        std::thread t;
-        std::atomic<bool> is_running;
+        RetryPolicy retryPolicy;
+        std::shared_ptr<Sampler> sampler;
+        SdkMetrics selfMetrics;
+        std::unique_ptr<IngestionLane> metricsLane;
+        std::unique_ptr<IngestionLane> histogramLane;
+        std::unique_ptr<IngestionLane> tracingLane;
+        std::unique_ptr<IngestionLane> spanLogsLane;
+        // reports the client's own stats through the client, if enabled
+        std::unique_ptr<MetricRegistry> sdkMetrics;
     };
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include "Striped.h"
+
+namespace wavefront {
+    /**
+    * Monotonic count reported as its running total. Increments only touch the calling core's stripe, so hot
+    * counters can be updated from many threads at once.
+    */
+    class Counter {
+    public:
+        inline void inc(long n = 1) {
+            counts.local().fetch_add(n, std::memory_order_relaxed);
+        }
+
+        inline void dec(long n = 1) {
+            inc(-n);
+        }
+
+        long getCount() {
+            long count = 0;
+            counts.forEach([&count](std::atomic<long> &cell) {
+                count += cell.load(std::memory_order_relaxed);
+            });
+            return count;
+        }
+
+    private:
+        Striped<std::atomic<long>> counts;
+    };
+
+    /**
+    * Count reported as the increments since the last report, which Wavefront adds up on the server side.
+    * Aggregates any number of increments into one sendDeltaCounter per reporting interval.
+    */
+    class DeltaCounter {
+    public:
+        inline void inc(long n = 1) {
+            counts.local().fetch_add(n, std::memory_order_relaxed);
+        }
+
+        // increments since the last reset
+        long getCount() {
+            long count = 0;
+            counts.forEach([&count](std::atomic<long> &cell) {
+                count += cell.load(std::memory_order_relaxed);
+            });
+            return count;
+        }
+
+        // increments since the last reset; every increment is counted by exactly one reset
+        long getAndReset() {
+            long count = 0;
+            counts.forEach([&count](std::atomic<long> &cell) {
+                count += cell.exchange(0, std::memory_order_relaxed);
+            });
+            return count;
+        }
+
+    private:
+        Striped<std::atomic<long>> counts;
+    };
+}
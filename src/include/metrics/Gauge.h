@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+
+namespace wavefront {
+    /**
+    * Value that is set by the application and reported as is. For a value computed on demand, register a
+    * callback gauge with MetricRegistry instead.
+    */
+    class Gauge {
+    public:
+        Gauge() : value(0) {
+        }
+
+        inline void set(double value) {
+            this->value.store(value, std::memory_order_relaxed);
+        }
+
+        inline double getValue() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<double> value;
+    };
+}
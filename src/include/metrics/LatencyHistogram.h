@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "Striped.h"
+
+namespace wavefront {
+    /**
+    * Durations counted in power of two buckets of nanoseconds, for percentiles that are cheap to record. An
+    * update is three relaxed atomic operations on the calling core's stripe, so the SDK can time its own hot
+    * paths; percentiles are interpolated within a bucket and so are accurate to within a factor of two.
+    *
+    * Counts only grow. The difference of two snapshots describes the durations recorded between them.
+    */
+    class LatencyHistogram {
+    public:
+        // bucket i holds durations of less than 2^i nanoseconds that are not in bucket i - 1
+        const static int BUCKETS = 48;
+
+        struct Snapshot {
+            Snapshot() : buckets(BUCKETS, 0) {
+            }
+
+            long count = 0;
+            long totalNanos = 0;
+            long maxNanos = 0;
+            std::vector<long> buckets;
+
+            double meanMicros() const;
+
+            // duration below which the given fraction of the recorded durations fall, 0 if there are none
+            double percentileMicros(double fraction) const;
+
+            // the longest duration; between two snapshots the upper bound of the highest bucket updated
+            double maxMicros() const;
+
+            // durations recorded after earlier was taken
+            Snapshot since(const Snapshot &earlier) const;
+        };
+
+        void update(std::chrono::nanoseconds duration);
+
+        Snapshot snapshot();
+
+    private:
+        struct Cell {
+            Cell() {
+                for (auto &bucket : buckets) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            std::atomic<long> buckets[BUCKETS];
+            std::atomic<long> totalNanos{0};
+            std::atomic<long> maxNanos{0};
+        };
+
+        Striped<Cell> cells;
+    };
+}
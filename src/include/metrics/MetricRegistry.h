@@ -0,0 +1,156 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Counter.h"
+#include "Gauge.h"
+#include "Timer.h"
+#include "WavefrontHistogram.h"
+#include "../common/WavefrontSender.h"
+
+namespace wavefront {
+    /**
+    * In-process registry of counters, delta counters, gauges, timers and histograms that are aggregated in memory and
+    * reported through a WavefrontSender once per reporting interval, so a counter incremented at any rate
+    * costs one point per interval on the wire.
+    *
+    * Metrics are identified by name and tags; asking for the same metric again returns the same instance.
+    * Each timer is reported as <name>.count, <name>.mean, <name>.min and <name>.max in milliseconds, and
+    * only for intervals in which it was updated. Histograms send each of their windows through
+    * sendDistribution once it has ended.
+    *
+    * Close the registry before the sender it reports through.
+    */
+    class MetricRegistry {
+    public:
+        typedef std::map<std::string, std::string> Tags;
+
+        // nested class for registry builder
+        struct Builder {
+            Builder(WavefrontSender &sender) : sender(sender) {
+            }
+
+            Builder &setReportingInterval(int reportingIntervalSeconds) {
+                this->reportingIntervalSeconds = reportingIntervalSeconds;
+                return *this;
+            }
+
+            // source of every reported metric, empty for the sender's default source
+            Builder &setSource(const std::string &source) {
+                this->source = source;
+                return *this;
+            }
+
+            // tags added to every reported metric, overridden by the metric's own tags
+            Builder &setTags(const Tags &tags) {
+                this->tags = tags;
+                return *this;
+            }
+
+            MetricRegistry *build() {
+                return new MetricRegistry(this);
+            }
+
+            WavefrontSender &sender;
+            int reportingIntervalSeconds = 60;
+            std::string source;
+            Tags tags;
+        };
+
+        ~MetricRegistry();
+
+        /**
+         * Return the metric of the given name and tags, creating it on first use.
+         * Safe to call from multiple threads.
+         *
+         * @throws std::invalid_argument if name is empty or already names a metric of another kind
+         */
+        std::shared_ptr<Counter> counter(const std::string &name, const Tags &tags = {});
+
+        std::shared_ptr<DeltaCounter> deltaCounter(const std::string &name, const Tags &tags = {});
+
+        std::shared_ptr<Gauge> gauge(const std::string &name, const Tags &tags = {});
+
+        std::shared_ptr<Timer> timer(const std::string &name, const Tags &tags = {});
+
+        // granularities only apply when the histogram is created
+        std::shared_ptr<WavefrontHistogram>
+        histogram(const std::string &name, const Tags &tags = {},
+                  const std::set<HistogramGranularity> &granularities = {HistogramGranularity::MINUTE});
+
+        /**
+         * Register a gauge whose value is computed by callback on the reporting thread, replacing a callback
+         * registered before under the same name and tags.
+         *
+         * @throws std::invalid_argument if name is empty or already names a metric of another kind
+         */
+        void gauge(const std::string &name, std::function<double()> callback, const Tags &tags = {});
+
+        // run callback on the reporting thread at the start of every report, for gauges that share a snapshot
+        void beforeReport(std::function<void()> callback);
+
+        // start the thread that reports every metric once per reporting interval
+        void start();
+
+        // send the current values of every metric through the sender
+        void report();
+
+        // stop the reporting thread after a final report; the sender is left open
+        void close();
+
+    private:
+        enum class Kind {
+            COUNTER, DELTA_COUNTER, GAUGE, CALLBACK_GAUGE, TIMER, HISTOGRAM
+        };
+
+        struct Entry {
+            Kind kind;
+            std::string name;
+            std::shared_ptr<const TagSet> tags;
+            std::shared_ptr<void> metric;
+            std::function<double()> callback;
+            // series of the reported values: one, or count, mean, min and max of a timer
+            std::vector<std::shared_ptr<const MetricSeries>> series;
+        };
+
+        MetricRegistry(Builder *builder);
+
+        /**
+         * Find or create the entry of a metric, under mutex. Entries are read by reports without the lock, so
+         * changing the kind or callback of an existing entry means storing a new one in its place.
+         */
+        std::shared_ptr<Entry> &lookup(const std::string &name, const Tags &tags, Kind kind);
+
+        template<typename Metric>
+        std::shared_ptr<Metric> metric(const std::string &name, const Tags &tags, Kind kind);
+
+        // with closing, histograms also send their open windows
+        void report(bool closing);
+
+        void reportEntry(Entry &entry, long timestamp, bool closing);
+
+        void run();
+
+        WavefrontSender &sender;
+        int reportingIntervalSeconds;
+        std::string source;
+        Tags commonTags;
+
+        // metrics by name and serialized tags
+        std::map<std::string, std::shared_ptr<Entry>> entries;
+        std::vector<std::function<void()>> reportCallbacks;
+        std::mutex mutex;
+
+        std::thread reporter;
+        std::mutex reporterMutex;
+        std::condition_variable reporterCondition;
+        bool is_running = false;
+        bool closed = false;
+    };
+}
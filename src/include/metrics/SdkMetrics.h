@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include "Counter.h"
+#include "LatencyHistogram.h"
+
+namespace wavefront {
+    class MetricRegistry;
+
+    /**
+    * What a sender has done since it was built, see WavefrontDirectIngestionClient::getStats() and
+    * WavefrontProxyClient::getStats(). Latencies are in microseconds.
+    */
+    struct SenderStats {
+        // points serialized and queued for direct ingestion, or written to the proxy
+        long pointsSent = 0;
+        // points that failed to serialize
+        long pointsInvalid = 0;
+        // points lost to a full queue or buffer, a failed write to the proxy, or a report given up on or rejected
+        long pointsDropped = 0;
+        long bytesSerialized = 0;
+        // reports to Wavefront, or writes to the proxy
+        long reports = 0;
+        long reportErrors = 0;
+        // bytes on the wire: compressed reports accepted by Wavefront, or bytes written to the proxy
+        long bytesSent = 0;
+        // uncompressed and compressed size of the reports, direct ingestion only
+        long compressedBytesIn = 0;
+        long compressedBytesOut = 0;
+        size_t queuedPoints = 0;
+        size_t queuedBytes = 0;
+        // a sample of the points, see SdkMetrics::SerializationTimer
+        LatencyHistogram::Snapshot serialization;
+        // per report, direct ingestion only
+        LatencyHistogram::Snapshot compression;
+        // per report or write
+        LatencyHistogram::Snapshot report;
+
+        inline double compressionRatio() const {
+            return compressedBytesOut > 0 ? static_cast<double>(compressedBytesIn) / compressedBytesOut : 0;
+        }
+    };
+
+    /**
+    * Counters and latencies a sender keeps about itself. Updates touch the calling core's stripe only, so they
+    * add little to the paths they measure.
+    */
+    struct SdkMetrics {
+        /**
+        * Times the serialization of the point in its scope, for one point in SAMPLE_RATE per thread. Reading the
+        * clock costs about as much as serializing a small point, so the rest go untimed.
+        */
+        class SerializationTimer {
+        public:
+            explicit SerializationTimer(SdkMetrics &metrics);
+
+            ~SerializationTimer();
+
+            const static unsigned SAMPLE_RATE = 16;
+
+        private:
+            SerializationTimer(const SerializationTimer &);
+
+            SerializationTimer &operator=(const SerializationTimer &);
+
+            LatencyHistogram *histogram;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        Counter pointsSent;
+        Counter pointsInvalid;
+        Counter pointsDropped;
+        Counter bytesSerialized;
+        Counter reports;
+        Counter reportErrors;
+        Counter bytesSent;
+        Counter compressedBytesIn;
+        Counter compressedBytesOut;
+        LatencyHistogram serialization;
+        LatencyHistogram compression;
+        LatencyHistogram report;
+
+        // counters and latencies; the queue sizes are left for the sender to fill in
+        SenderStats snapshot();
+
+        /**
+        * Report the stats of a sender through a registry as gauges named prefix + "points.sent" and so on.
+        * Counts are totals, latencies describe the reporting interval.
+        *
+        * @param stats called once per report
+        */
+        static void registerGauges(MetricRegistry &registry, const std::string &prefix,
+                                   std::function<SenderStats()> stats);
+    };
+}
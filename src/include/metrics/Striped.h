@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace wavefront {
+    /**
+    * Number of stripes and the stripe of the calling thread, shared by all Striped instances.
+    */
+    class Stripes {
+    public:
+        // a power of two covering the cores of the machine, at most MAX_STRIPES
+        static size_t count();
+
+        // stripe of the core the calling thread runs on
+        static size_t index();
+
+        const static size_t MAX_STRIPES = 64;
+    };
+
+    /**
+    * One Cell per core, each on its own cache line, so that threads updating a hot metric on different cores
+    * don't contend on the same atomic. Readers combine the cells with forEach.
+    */
+    template<typename Cell>
+    class Striped {
+    public:
+        Striped() : cells(new PaddedCell[Stripes::count()]()) {
+        }
+
+        // cell of the calling thread's core
+        inline Cell &local() {
+            return cells[Stripes::index()].cell;
+        }
+
+        template<typename Function>
+        void forEach(Function function) {
+            for (size_t i = 0; i < Stripes::count(); i++) {
+                function(cells[i].cell);
+            }
+        }
+
+    private:
+        const static size_t CACHE_LINE = 64;
+
+        // padded rather than aligned, as new does not honor extended alignment before C++17
+        struct PaddedCell {
+            Cell cell;
+            char padding[CACHE_LINE - sizeof(Cell) % CACHE_LINE];
+        };
+
+        std::unique_ptr<PaddedCell[]> cells;
+    };
+}
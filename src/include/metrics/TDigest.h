@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace wavefront {
+    /**
+    * Merging t-digest: a mergeable sketch of a distribution in a bounded number of centroids, small near the
+    * tails and larger around the median.
+    *
+    * Values are appended to a buffer behind the centroids and merged into them, in place, whenever the buffer
+    * fills up. All storage is allocated by the constructor, so adding a value never allocates.
+    *
+    * Not thread-safe; see WavefrontHistogram for concurrent recording.
+    */
+    class TDigest {
+    public:
+        /**
+         * @param compression roughly the number of centroids kept; higher is more accurate and slower
+         */
+        explicit TDigest(int compression = 100);
+
+        inline void add(double value) {
+            add(value, 1);
+        }
+
+        void add(double value, double weight);
+
+        // add every centroid of other, which is compressed in the process
+        void merge(TDigest &other);
+
+        // forget every value, keeping the storage
+        void reset();
+
+        inline bool empty() const {
+            return used == 0;
+        }
+
+        inline double getCount() const {
+            return totalWeight;
+        }
+
+        // estimated value at quantile q, 0 to 1; NaN if empty
+        double quantile(double q);
+
+        // centroids as (mean, count) pairs in ascending order of their means, see WavefrontSender::sendDistribution
+        void getCentroids(std::list<std::pair<double, int>> &centroids);
+
+    private:
+        struct Centroid {
+            double mean;
+            double weight;
+        };
+
+        // merge the buffered values into the centroids
+        void compress();
+
+        // highest quantile a centroid starting at quantile q may reach
+        double quantileLimit(double q);
+
+        double compression;
+        size_t maxCentroids;
+        // merged centroids, followed by buffered values
+        std::vector<Centroid> centroids;
+        // copy of the merged centroids while a merge runs
+        std::vector<Centroid> previous;
+        size_t merged = 0;
+        size_t used = 0;
+        double totalWeight = 0;
+    };
+}
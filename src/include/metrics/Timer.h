@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include "Striped.h"
+
+namespace wavefront {
+    /**
+    * Durations aggregated per reporting interval into their count, mean, minimum and maximum.
+    */
+    class Timer {
+    public:
+        // times the scope it lives in
+        class Context {
+        public:
+            explicit Context(Timer &timer) : timer(&timer), start(std::chrono::steady_clock::now()) {
+            }
+
+            Context(Context &&other) : timer(other.timer), start(other.start) {
+                other.timer = nullptr;
+            }
+
+            ~Context() {
+                stop();
+            }
+
+            // record the time elapsed since construction, only the first call counts
+            void stop() {
+                if (timer != nullptr) {
+                    timer->update(std::chrono::steady_clock::now() - start);
+                    timer = nullptr;
+                }
+            }
+
+        private:
+            Context(const Context &);
+
+            Context &operator=(const Context &);
+
+            Timer *timer;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        struct Snapshot {
+            long count = 0;
+            double meanMillis = 0;
+            double minMillis = 0;
+            double maxMillis = 0;
+        };
+
+        void update(std::chrono::nanoseconds duration);
+
+        inline Context time() {
+            return Context(*this);
+        }
+
+        /**
+        * Durations recorded since the last reset. An update racing with the reset may have its count and its
+        * duration land in different intervals.
+        */
+        Snapshot getAndReset();
+
+    private:
+        struct Cell {
+            std::atomic<long> count{0};
+            std::atomic<long> totalNanos{0};
+            std::atomic<long> minNanos{std::numeric_limits<long>::max()};
+            std::atomic<long> maxNanos{0};
+        };
+
+        Striped<Cell> cells;
+    };
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#include "Striped.h"
+#include "TDigest.h"
+#include "../common/HistogramGranularity.h"
+
+namespace wavefront {
+    /**
+    * Histogram that accumulates values client-side into per-minute, per-hour and per-day windows, ready to be
+    * sent with WavefrontSender::sendDistribution once a window has ended.
+    *
+    * Each core records into its own t-digest behind a spin lock, keyed by the minute the value belongs to.
+    * flush() folds completed minutes into the windows of every configured granularity and hands out the
+    * windows that have ended. Recording costs a clock read and a buffer append, and never allocates.
+    */
+    class WavefrontHistogram {
+    public:
+        // receives the centroids of a window and the start of the window in milliseconds since the epoch
+        typedef std::function<void(HistogramGranularity granularity, long windowStartMillis,
+                                   const std::list<std::pair<double, int>> &centroids)> Sink;
+
+        /**
+         * @param granularities windows to aggregate and report
+         * @param compression t-digest compression of every window, see TDigest
+         */
+        explicit WavefrontHistogram(const std::set<HistogramGranularity> &granularities =
+                                            {HistogramGranularity::MINUTE},
+                                    int compression = 100);
+
+        void update(double value);
+
+        /**
+         * Hand every window that ended by nowMillis to sink. Only one thread may flush at a time.
+         *
+         * @param flushOpen also hand out the windows still open, e.g. on shutdown
+         */
+        void flush(long nowMillis, const Sink &sink, bool flushOpen = false);
+
+    private:
+        struct Stripe {
+            Stripe(int compression) : current(compression), previous(compression) {
+            }
+
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+            // minute being recorded
+            long currentMinute = 0;
+            TDigest current;
+            // the minute before, until the next flush picks it up
+            long previousMinute = 0;
+            TDigest previous;
+        };
+
+        struct Window {
+            Window(HistogramGranularity granularity, int compression)
+                    : granularity(granularity), digest(compression) {
+            }
+
+            HistogramGranularity granularity;
+            long startMillis = 0;
+            TDigest digest;
+        };
+
+        // fold the values of a completed minute into every window, handing out windows it moves past
+        void collect(long minuteMillis, TDigest &digest, const Sink &sink);
+
+        void emit(HistogramGranularity granularity, long startMillis, TDigest &digest, const Sink &sink);
+
+        static long windowMillis(HistogramGranularity granularity);
+
+        std::vector<std::unique_ptr<Stripe>> stripes;
+        std::vector<Window> windows;
+        // flusher's empty digest, swapped with a stripe's completed minute
+        TDigest scratch;
+        std::mutex flushMutex;
+    };
+}
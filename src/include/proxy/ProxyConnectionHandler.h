@@ -1,26 +1,50 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <vector>
+#include "../common/OutputBuffer.h"
+#include "../common/RetryPolicy.h"
 #include "../common/Socket.h"
+#include "../metrics/SdkMetrics.h"
 
 namespace wavefront {
     /**
     * Connection Handler class for sending data to a Wavefront proxy listening on a given port.
     *
+    * Data is either written to the socket by the calling thread (sendData) or appended to an in-memory
+    * buffer (bufferData) that a background writer drains with flushBuffer in coalesced gather writes.
+    * In non-blocking mode the buffer is drained by a ProxyEventLoop through startConnect, finishConnect
+    * and writeBuffered instead.
+    *
     * @author Mengran Wang (mengranw@vmware.com)
     */
     class ProxyConnectionHandler {
     public:
         ProxyConnectionHandler(std::string &hostName, unsigned short port);
 
+        /**
+         * @param maxBufferedBytes  upper bound of data held by bufferData before points are dropped
+         */
+        ProxyConnectionHandler(std::string &hostName, unsigned short port, size_t maxBufferedBytes);
+
         ~ProxyConnectionHandler();
 
         void close();
 
         void connect() throw(SocketException);
 
+        // TCP options applied whenever a connection is established
+        void setSocketOptions(const SocketOptions &options);
+
+        // space the reconnects after send failures on the policy's backoff instead of reconnecting every time
+        void setRetryPolicy(RetryPolicy *retryPolicy);
+
+        // count the points sent and dropped and time the writes, see WavefrontProxyClient::getStats()
+        void setMetrics(SdkMetrics *metrics);
+
         /**
         * Sends the given data to the WavefrontProxyClient proxy.
         * one improvement we have is to reset socket before throwing SocketException
@@ -30,6 +54,72 @@ namespace wavefront {
         */
         void sendData(std::string &lineData);
 
+        /**
+        * Sends length bytes of line data starting at data to the WavefrontProxyClient proxy.
+        *
+        * @param data line data in a WavefrontProxyClient supported format
+        * @param length number of bytes to send
+        * @param points number of points in the data
+        * @throws Exception If there was failure sending the data
+        */
+        void sendData(const char *data, size_t length, int points = 1);
+
+        /**
+        * Appends line data to the write buffer without touching the socket. The data is dropped, and
+        * counted as a failure, if the buffer already holds maxBufferedBytes.
+        *
+        * @param data line data in a WavefrontProxyClient supported format
+        * @param length number of bytes to buffer
+        * @param points number of points in the data
+        * @return the number of bytes buffered after appending
+        */
+        size_t bufferData(const char *data, size_t length, int points = 1);
+
+        /**
+        * Writes everything buffered so far to the proxy in as few system calls as possible.
+        * On failure the buffered data is dropped and the connection is re-established. While a failed
+        * reconnect waits for its backoff, data stays buffered.
+        *
+        * @throws Exception If there was failure reconnecting
+        */
+        void flushBuffer();
+
+        /**
+        * Replaces the socket with a non-blocking one and starts connecting it. If the connection is still in
+        * progress, finishConnect must be called once the socket becomes writable.
+        *
+        * @return true if the connection was established immediately
+        * @throws SocketException If the connection attempt failed
+        */
+        bool startConnect() throw(SocketException);
+
+        void finishConnect() throw(SocketException);
+
+        /**
+        * Writes buffered data to a non-blocking connection until everything is written or the socket buffer
+        * is full. A chunk written partially is resumed by the next call.
+        *
+        * @return true if no buffered data is left
+        * @throws SocketException If the connection failed
+        */
+        bool writeBuffered() throw(SocketException);
+
+        /**
+        * Closes a failed non-blocking connection and drops the data it was in the middle of writing. Data
+        * not yet picked up for writing stays buffered for the next connection.
+        */
+        void dropConnection();
+
+        // drop whatever is still buffered, counting its points as dropped; the buffer must not be written meanwhile
+        void dropBuffered();
+
+        // descriptor of the current socket, -1 if there is none
+        int getDescriptor();
+
+        inline size_t getBufferedBytes() {
+            return bufferedBytes.load();
+        }
+
         inline int getFailureCount() {
             return failures.load();
         }
@@ -47,11 +137,44 @@ namespace wavefront {
         }
 
     private:
+        // replace the socket after a send failure, unless the last reconnect failed and its backoff is running
+        void reconnect() throw(SocketException);
+
+        // move the pending chunks to chunks, which must be empty, and return the number of points in them
+        long takePending(std::vector<std::unique_ptr<OutputBuffer>> &chunks);
+
+        // bytes of the chunks being written that are not written yet, in non-blocking mode
+        size_t unwrittenBytes();
+
+        // release chunks that have been written or dropped and keep a few of them for reuse
+        void recycle(std::vector<std::unique_ptr<OutputBuffer>> &chunks);
+
         std::unique_ptr<CommunicatingSocket> socket = nullptr;
         std::mutex mutex;
-        std::string &hostName;
+        std::string hostName;
         unsigned short port;
+        SocketOptions options;
+        RetryPolicy *retryPolicy = nullptr;
+        SdkMetrics *metrics = nullptr;
+        // reconnects failed since the last successful one, and when the next one may be tried
+        int failedReconnects = 0;
+        std::chrono::steady_clock::time_point reconnectAt;
+
+        // write buffer: chunks filled by bufferData, written out and recycled by flushBuffer
+        std::mutex bufferMutex;
+        std::vector<std::unique_ptr<OutputBuffer>> pendingChunks;
+        // points in pendingChunks, counted as sent once they are written or as dropped if the write fails
+        long pendingPoints = 0;
+        std::vector<std::unique_ptr<OutputBuffer>> freeChunks;
+        std::atomic<size_t> bufferedBytes;
+        size_t maxBufferedBytes;
+
+        // non-blocking mode: chunks being written by writeBuffered and the position reached in them
+        std::vector<std::unique_ptr<OutputBuffer>> writingChunks;
+        std::vector<iovec> writingBuffers;
+        size_t writingIndex = 0;
+        long writingPoints = 0;
 
         std::atomic<int> failures;
     };
-}
\ No newline at end of file
+}
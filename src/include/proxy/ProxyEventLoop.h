@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "ProxyConnectionHandler.h"
+#include "../common/RetryPolicy.h"
+
+#if defined(__linux__)
+#define WAVEFRONT_HAVE_EPOLL 1
+#endif
+
+#ifdef WAVEFRONT_HAVE_EPOLL
+namespace wavefront {
+    /**
+    * Single-threaded epoll loop driving the proxy connections of a WavefrontProxyClient in non-blocking mode.
+    *
+    * The loop thread connects asynchronously and writes what the handlers have buffered whenever it is woken
+    * up or the flush interval elapses. When a socket buffer fills up it waits for writability instead of
+    * blocking, so producer threads only ever append to the handler buffers; a slow or unreachable proxy makes
+    * the buffers fill up and new points get dropped. Failed connections are retried on the RetryPolicy's backoff.
+    */
+    class ProxyEventLoop {
+    public:
+        ProxyEventLoop(const std::vector<ProxyConnectionHandler *> &handlers, int flushIntervalMillis,
+                       RetryPolicy &retryPolicy);
+
+        ~ProxyEventLoop();
+
+        void start();
+
+        // wake the loop to write buffered data now, only the first call until the loop wakes up costs a syscall
+        void requestFlush();
+
+        // write out buffered data, giving up after drainTimeoutMillis, and stop the loop thread
+        void stop(int drainTimeoutMillis);
+
+    private:
+        enum class State {
+            DISCONNECTED, CONNECTING, CONNECTED
+        };
+
+        struct Connection {
+            ProxyConnectionHandler *handler;
+            State state = State::DISCONNECTED;
+            int descriptor = -1;
+            bool watchingWrite = false;
+            // connection attempts failed since the last successful one
+            int failedAttempts = 0;
+            std::chrono::steady_clock::time_point retryAt;
+        };
+
+        void run();
+
+        void connect(Connection &connection);
+
+        void handleEvent(Connection &connection, uint32_t events);
+
+        void write(Connection &connection);
+
+        void watchWrite(Connection &connection, bool watch);
+
+        // close the connection and schedule the next attempt
+        void fail(Connection &connection);
+
+        bool drained();
+
+        int nextTimeoutMillis(std::chrono::steady_clock::time_point now);
+
+        std::vector<Connection> connections;
+        int flushIntervalMillis;
+        RetryPolicy &retryPolicy;
+        int epollDescriptor = -1;
+        int wakeupDescriptor = -1;
+
+        std::thread loop;
+        std::atomic<bool> wakeupPending;
+        std::atomic<bool> stopping;
+        std::chrono::steady_clock::time_point drainDeadline;
+    };
+}
+#endif
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <condition_variable>
+#include <thread>
 #include "ProxyConnectionHandler.h"
+#include "ProxyEventLoop.h"
 #include "../common/WavefrontSender.h"
+#include "../metrics/MetricRegistry.h"
+#include "../metrics/SdkMetrics.h"
+#include "../sampling/Sampler.h"
 
 namespace wavefront {
     /**
@@ -13,23 +19,103 @@ namespace wavefront {
         // nested class for client builder
         struct Builder {
             Builder(const std::string &hostName) : hostName(hostName) {
+                retryOptions.initialBackoffMillis = 100;
+                retryOptions.maxBackoffMillis = 30 * 1000;
+                retryOptions.maxAttempts = 0;
             }
 
-            Builder setMetricsPort(unsigned short metricsPort) {
+            Builder &setMetricsPort(unsigned short metricsPort) {
                 this->metricsPort = metricsPort;
                 return *this;
             }
 
-            Builder setTracingPort(unsigned short tracingPort) {
+            Builder &setTracingPort(unsigned short tracingPort) {
                 this->tracingPort = tracingPort;
                 return *this;
             }
 
-            Builder setDistributionPort(unsigned short distributionPort) {
+            Builder &setDistributionPort(unsigned short distributionPort) {
                 this->distributionPort = distributionPort;
                 return *this;
             }
 
+            /**
+             * In async mode points are appended to an in-memory buffer per connection and a background
+             * thread writes them to the proxy, coalescing many points into each system call.
+             */
+            Builder &setAsyncMode(bool asyncMode) {
+                this->asyncMode = asyncMode;
+                return *this;
+            }
+
+            // async mode: write a connection's buffer as soon as it holds this many bytes
+            Builder &setFlushThresholdBytes(size_t flushThresholdBytes) {
+                this->flushThresholdBytes = flushThresholdBytes;
+                return *this;
+            }
+
+            // async mode: write buffered points at least this often
+            Builder &setFlushIntervalMillis(int flushIntervalMillis) {
+                this->flushIntervalMillis = flushIntervalMillis;
+                return *this;
+            }
+
+            // async mode: per connection buffer limit, points beyond it are dropped
+            Builder &setMaxBufferedBytes(size_t maxBufferedBytes) {
+                this->maxBufferedBytes = maxBufferedBytes;
+                return *this;
+            }
+
+            /**
+             * Non-blocking I/O: the connections are owned by a single epoll thread that connects, writes and
+             * reconnects without ever blocking the sending threads. Buffering works as in async mode and the
+             * async mode settings apply. Linux only, other platforms fall back to async mode.
+             */
+            Builder &setNonBlockingIO(bool nonBlockingIO) {
+                this->nonBlockingIO = nonBlockingIO;
+                return *this;
+            }
+
+            // disable Nagle's algorithm on the proxy connections
+            Builder &setTcpNoDelay(bool tcpNoDelay) {
+                this->socketOptions.tcpNoDelay = tcpNoDelay;
+                return *this;
+            }
+
+            // kernel send buffer size of the proxy connections, 0 keeps the system default
+            Builder &setSendBufferSize(int sendBufferSize) {
+                this->socketOptions.sendBufferSize = sendBufferSize;
+                return *this;
+            }
+
+            // async and non-blocking modes: cork the connection while a batch of buffered points is written
+            Builder &setCorking(bool corking) {
+                this->socketOptions.cork = corking;
+                return *this;
+            }
+
+            // backoff between attempts to reconnect a failed connection; connections are retried without bound
+            Builder &setRetryOptions(const RetryOptions &retryOptions) {
+                this->retryOptions = retryOptions;
+                this->retryOptions.maxAttempts = 0;
+                return *this;
+            }
+
+            /**
+             * Decide which spans are sent before they are serialized, see Sampler. Without a sampler every span
+             * is sent.
+             */
+            Builder &setSampler(std::shared_ptr<Sampler> sampler) {
+                this->sampler = std::move(sampler);
+                return *this;
+            }
+
+            // report getStats() through the client as ~sdk.cpp.proxy_sender.* metrics, 0 to not report them
+            Builder &setSdkMetricsInterval(int sdkMetricsIntervalSeconds) {
+                this->sdkMetricsIntervalSeconds = sdkMetricsIntervalSeconds;
+                return *this;
+            }
+
             WavefrontProxyClient *build() {
                 return new WavefrontProxyClient(this);
             }
@@ -38,36 +124,166 @@ namespace wavefront {
             unsigned short metricsPort = 0;
             unsigned short distributionPort = 0;
             unsigned short tracingPort = 0;
+
+            bool asyncMode = false;
+            size_t flushThresholdBytes = 64 * 1024;
+            int flushIntervalMillis = 100;
+            size_t maxBufferedBytes = 16 * 1024 * 1024;
+
+            bool nonBlockingIO = false;
+            SocketOptions socketOptions;
+            RetryOptions retryOptions;
+            std::shared_ptr<Sampler> sampler;
+            int sdkMetricsIntervalSeconds = 0;
         };
 
         void sendMetric(const std::string &name, double value, long timestamp = -1, const std::string &source = "",
                         std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendMetric(const std::string &name, double value, long timestamp, const std::string &source,
+                        const TagSet &tags) override;
+
+        std::shared_ptr<const MetricSeries>
+        registerSeries(const std::string &name, const std::string &source = "",
+                       const std::map<std::string, std::string> &tags = {}) override;
+
+        void sendMetric(const MetricSeries &series, double value, long timestamp = -1) override;
+
         void sendDeltaCounter(std::string &name, double value, const std::string &source = "",
                               std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendDeltaCounter(std::string &name, double value, const std::string &source,
+                              const TagSet &tags) override;
+
         void sendDistribution(const std::string &name, std::list<std::pair<double, int>> centroids,
                               std::set<HistogramGranularity> histogramGranularities, long timestamp = -1,
                               const std::string &source = "",
                               std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendDistribution(const std::string &name, const std::list<std::pair<double, int>> &centroids,
+                              const std::set<HistogramGranularity> &histogramGranularities, long timestamp,
+                              const std::string &source, const TagSet &tags) override;
+
         void sendSpan(const std::string &name, long startMillis, long durationMillis,
                       boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source = "",
                       std::list<boost::uuids::uuid> parents = {}, std::list<boost::uuids::uuid> followsFrom = {},
                       std::map<std::string, std::string> tags = {{}}) override;
 
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const TagSet &tags) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const std::map<std::string, std::string> &tags, const std::list<SpanLog> &spanLogs) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const TagSet &tags, const std::list<SpanLog> &spanLogs) override;
+
+        void sendMetric(boost::string_view name, double value, long timestamp, boost::string_view source,
+                        ArrayView<TagView> tags) override;
+
+        void sendDistribution(boost::string_view name, ArrayView<std::pair<double, int>> centroids,
+                              ArrayView<HistogramGranularity> histogramGranularities, long timestamp,
+                              boost::string_view source, ArrayView<TagView> tags) override;
+
+        void sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                      const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId, boost::string_view source,
+                      ArrayView<boost::uuids::uuid> parents, ArrayView<boost::uuids::uuid> followsFrom,
+                      ArrayView<TagView> tags) override;
+
+        void sendMetrics(const std::vector<MetricPoint> &metrics) override;
+
+        void sendSpans(const std::vector<SpanPoint> &spans) override;
+
 
         int getFailureCount() override;
 
+        /**
+        * Points, bytes and write latencies of every connection. The proxy takes points as they are written,
+        * so there are no compression stats, and the queue is the bytes buffered in async mode.
+        */
+        SenderStats getStats();
+
+        // reconnects scheduled after connection failures
+        inline const RetryPolicy &getRetryPolicy() const {
+            return retryPolicy;
+        }
+
         void close() override;
 
+        ~WavefrontProxyClient() {
+            close();
+        }
+
     private:
         WavefrontProxyClient(Builder *builder);
 
+        // serialize and send a point; Tags is either a tag map or a TagSet
+        template<typename Tags>
+        void sendMetricLine(boost::string_view name, double value, long timestamp, boost::string_view source,
+                            const Tags &tags);
+
+        // Centroids and Granularities are containers or ArrayViews
+        template<typename Centroids, typename Granularities, typename Tags>
+        void sendDistributionLine(boost::string_view name, const Centroids &centroids,
+                                  const Granularities &histogramGranularities, long timestamp,
+                                  boost::string_view source, const Tags &tags);
+
+        // Ids are lists or ArrayViews of UUIDs
+        template<typename Ids, typename Tags>
+        void sendSpanLine(boost::string_view name, long startMillis, long durationMillis,
+                          const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                          boost::string_view source, const Ids &parents, const Ids &followsFrom, const Tags &tags,
+                          const std::list<SpanLog> &spanLogs);
+
+        RetryPolicy retryPolicy;
+        std::shared_ptr<Sampler> sampler;
+        SdkMetrics selfMetrics;
         std::unique_ptr<ProxyConnectionHandler> metricHandler = nullptr;
         std::unique_ptr<ProxyConnectionHandler> distributionHandler = nullptr;
         std::unique_ptr<ProxyConnectionHandler> tracingHandler = nullptr;
+        // reports the client's own stats through the client, if enabled
+        std::unique_ptr<MetricRegistry> sdkMetrics = nullptr;
+
+        // send line data of the given number of points right away or, in async mode, buffer it for the writer
+        // thread
+        void dispatch(ProxyConnectionHandler &handler, const OutputBuffer &lineData, int points = 1);
+
+        // dispatch the lines of a batch, counting a failure to send them
+        void dispatchBatch(ProxyConnectionHandler &handler, OutputBuffer &lineData, int points);
+
+        // start reporting getStats() once the client is ready to send, if an interval is set
+        void startSdkMetrics(int reportingIntervalSeconds);
+
+        // have the writer thread or the event loop write the buffers before the next interval
+        void requestFlush();
+
+        void writeTask();
+
+        void flushBuffers();
+
         // source is hardcoded
         std::string defaultSource = "wavefrontProxySender";
+
+        bool asyncMode;
+        size_t flushThresholdBytes;
+        int flushIntervalMillis;
+
+        // writer thread of async mode
+        std::thread writer;
+        std::mutex writerMutex;
+        std::condition_variable writerCondition;
+        std::atomic<bool> flushRequested;
+        std::atomic<bool> is_running;
+
+#ifdef WAVEFRONT_HAVE_EPOLL
+        // replaces the writer thread in non-blocking mode
+        std::unique_ptr<ProxyEventLoop> eventLoop = nullptr;
+#endif
     };
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Sampler.h"
+
+namespace wavefront {
+    /**
+    * Samples a span if any of its samplers does, e.g. a ProbabilisticSampler that keeps a baseline of traces
+    * together with a DurationSampler that keeps every slow span. Samplers are asked in order until one samples
+    * the span, so cheap samplers go first.
+    */
+    class CompositeSampler : public Sampler {
+    public:
+        explicit CompositeSampler(std::vector<std::shared_ptr<Sampler>> samplers);
+
+        bool sample(boost::string_view operationName, const boost::uuids::uuid &traceId,
+                    long durationMillis) override;
+
+    private:
+        std::vector<std::shared_ptr<Sampler>> samplers;
+    };
+}
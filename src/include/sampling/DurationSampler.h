@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Sampler.h"
+
+namespace wavefront {
+    /**
+    * Samples spans that take at least the given duration.
+    */
+    class DurationSampler : public Sampler {
+    public:
+        explicit DurationSampler(long thresholdMillis) : thresholdMillis(thresholdMillis) {
+        }
+
+        bool sample(boost::string_view /*operationName*/, const boost::uuids::uuid &/*traceId*/,
+                    long durationMillis) override {
+            return durationMillis >= thresholdMillis;
+        }
+
+    private:
+        long thresholdMillis;
+    };
+}
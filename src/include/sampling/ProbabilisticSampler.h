@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Sampler.h"
+
+namespace wavefront {
+    /**
+    * Samples a fixed fraction of traces. The decision only depends on the trace ID, so every service that
+    * samples at the same rate keeps or drops all spans of a trace alike. Uses the same hash of the trace ID as
+    * the RateSampler of the other Wavefront SDKs.
+    */
+    class ProbabilisticSampler : public Sampler {
+    public:
+        /**
+        * @param samplingRate fraction of traces to keep, between 0.0 and 1.0
+        */
+        explicit ProbabilisticSampler(double samplingRate);
+
+        bool sample(boost::string_view operationName, const boost::uuids::uuid &traceId,
+                    long durationMillis) override;
+
+    private:
+        // keep traces whose hash falls at or below the boundary, -1 to keep none
+        long boundary;
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include "Sampler.h"
+
+namespace wavefront {
+    /**
+    * Caps the spans sent per second with a token bucket: tokens accrue at the given rate up to a burst, and
+    * each sampled span takes one. The bucket is kept as the time at which it will next be full, so a decision
+    * is a single compare-and-swap without a lock.
+    *
+    * Limits spans rather than traces, so it is meant to bound the cost of a busy service, combined with a
+    * trace-consistent sampler if whole traces matter, see CompositeSampler.
+    */
+    class RateLimitingSampler : public Sampler {
+    public:
+        /**
+        * @param spansPerSecond rate of sampled spans
+        * @param burst spans that may be sampled at once after an idle period, at least 1
+        */
+        explicit RateLimitingSampler(double spansPerSecond, double burst = 1.0);
+
+        bool sample(boost::string_view operationName, const boost::uuids::uuid &traceId,
+                    long durationMillis) override;
+
+    private:
+        // nanoseconds it takes to earn one token
+        long long interval;
+        // nanoseconds of tokens the bucket holds when full
+        long long capacity;
+        // steady clock time in nanoseconds when the bucket is full again
+        std::atomic<long long> fullAt;
+    };
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <boost/utility/string_view.hpp>
+#include <boost/uuid/uuid.hpp>
+
+namespace wavefront {
+    /**
+    * Head-based sampling decision of a span. The senders consult their sampler before a span is serialized, so
+    * a span that is not sampled costs no more than the decision itself.
+    *
+    * Implementations must be thread-safe; every thread that sends spans calls sample() concurrently.
+    */
+    class Sampler {
+    public:
+        virtual ~Sampler() {
+        }
+
+        /**
+        * @param operationName name of the span
+        * @param traceId trace the span belongs to
+        * @param durationMillis duration of the span
+        * @return true if the span is to be sent
+        */
+        virtual bool sample(boost::string_view operationName, const boost::uuids::uuid &traceId,
+                            long durationMillis) = 0;
+    };
+}
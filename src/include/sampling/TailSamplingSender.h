@@ -0,0 +1,242 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include "ProbabilisticSampler.h"
+#include "../common/WavefrontSender.h"
+
+namespace wavefront {
+    /**
+    * WavefrontSender that samples whole traces after they are complete, in front of another sender.
+    *
+    * Spans are buffered per trace ID and a trace is decided once decisionWaitMillis have passed since its first
+    * span: it is sent if any of its spans has the tag error=true, if any span took at least slowTraceMillis, or
+    * if its trace ID falls into the baseline rate, see ProbabilisticSampler. Spans of a trace that arrive after
+    * its decision follow it for another decisionWaitMillis; later ones start a new decision.
+    *
+    * The buffer holds at most maxBufferedSpans spans. When it is full the oldest trace is decided early, with the
+    * spans buffered so far, and counted as evicted. Metrics, distributions and everything else are passed through.
+    *
+    * close() decides every buffered trace and then closes the wrapped sender.
+    */
+    class TailSamplingSender : public WavefrontSender {
+    public:
+        // nested class for sender builder
+        struct Builder {
+            Builder(WavefrontSender &sender) : sender(sender) {
+            }
+
+            // how long after its first span a trace is decided
+            Builder &setDecisionWaitMillis(int decisionWaitMillis) {
+                this->decisionWaitMillis = decisionWaitMillis;
+                return *this;
+            }
+
+            // spans buffered across all pending traces
+            Builder &setMaxBufferedSpans(size_t maxBufferedSpans) {
+                this->maxBufferedSpans = maxBufferedSpans;
+                return *this;
+            }
+
+            // keep traces with a span at least this long, 0 to not keep traces for their duration
+            Builder &setSlowTraceMillis(long slowTraceMillis) {
+                this->slowTraceMillis = slowTraceMillis;
+                return *this;
+            }
+
+            // fraction of the remaining traces that is kept
+            Builder &setBaselineRate(double baselineRate) {
+                this->baselineRate = baselineRate;
+                return *this;
+            }
+
+            TailSamplingSender *build() {
+                return new TailSamplingSender(this);
+            }
+
+            WavefrontSender &sender;
+            int decisionWaitMillis = 5000;
+            size_t maxBufferedSpans = 100000;
+            long slowTraceMillis = 1000;
+            double baselineRate = 0.01;
+        };
+
+        ~TailSamplingSender();
+
+        void sendMetric(const std::string &name, double value, long timestamp = -1, const std::string &source = "",
+                        std::map<std::string, std::string> tags = {{}}) override;
+
+        void sendMetric(const std::string &name, double value, long timestamp, const std::string &source,
+                        const TagSet &tags) override;
+
+        std::shared_ptr<const MetricSeries>
+        registerSeries(const std::string &name, const std::string &source = "",
+                       const std::map<std::string, std::string> &tags = {}) override;
+
+        void sendMetric(const MetricSeries &series, double value, long timestamp = -1) override;
+
+        void sendDeltaCounter(std::string &name, double value, const std::string &source = "",
+                              std::map<std::string, std::string> tags = {{}}) override;
+
+        void sendDeltaCounter(std::string &name, double value, const std::string &source,
+                              const TagSet &tags) override;
+
+        void sendDistribution(const std::string &name, std::list<std::pair<double, int>> centroids,
+                              std::set<HistogramGranularity> histogramGranularities, long timestamp = -1,
+                              const std::string &source = "",
+                              std::map<std::string, std::string> tags = {{}}) override;
+
+        void sendDistribution(const std::string &name, const std::list<std::pair<double, int>> &centroids,
+                              const std::set<HistogramGranularity> &histogramGranularities, long timestamp,
+                              const std::string &source, const TagSet &tags) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source = "",
+                      std::list<boost::uuids::uuid> parents = {}, std::list<boost::uuids::uuid> followsFrom = {},
+                      std::map<std::string, std::string> tags = {{}}) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const TagSet &tags) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const std::map<std::string, std::string> &tags, const std::list<SpanLog> &spanLogs) override;
+
+        void sendSpan(const std::string &name, long startMillis, long durationMillis,
+                      boost::uuids::uuid traceId, boost::uuids::uuid spanId, const std::string &source,
+                      const std::list<boost::uuids::uuid> &parents, const std::list<boost::uuids::uuid> &followsFrom,
+                      const TagSet &tags, const std::list<SpanLog> &spanLogs) override;
+
+        void sendMetric(boost::string_view name, double value, long timestamp, boost::string_view source,
+                        ArrayView<TagView> tags) override;
+
+        void sendDistribution(boost::string_view name, ArrayView<std::pair<double, int>> centroids,
+                              ArrayView<HistogramGranularity> histogramGranularities, long timestamp,
+                              boost::string_view source, ArrayView<TagView> tags) override;
+
+        void sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                      const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId, boost::string_view source,
+                      ArrayView<boost::uuids::uuid> parents, ArrayView<boost::uuids::uuid> followsFrom,
+                      ArrayView<TagView> tags) override;
+
+        // metrics are passed on as a batch; spans are buffered one by one
+        void sendMetrics(const std::vector<MetricPoint> &metrics) override;
+
+        int getFailureCount() override;
+
+        void close() override;
+
+        inline long getKeptTraceCount() const {
+            return keptTraces.load();
+        }
+
+        inline long getDroppedTraceCount() const {
+            return droppedTraces.load();
+        }
+
+        // traces decided early because the buffer was full
+        inline long getEvictedTraceCount() const {
+            return evictedTraces.load();
+        }
+
+        // spans not sent, whether buffered and dropped with their trace or arriving after a drop decision
+        inline long getDroppedSpanCount() const {
+            return droppedSpans.load();
+        }
+
+        inline long getBufferedSpanCount() const {
+            return bufferedSpans.load();
+        }
+
+    private:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+
+        struct BufferedSpan {
+            std::string name;
+            long startMillis;
+            long durationMillis;
+            boost::uuids::uuid spanId;
+            std::string source;
+            std::list<boost::uuids::uuid> parents;
+            std::list<boost::uuids::uuid> followsFrom;
+            std::map<std::string, std::string> tags;
+            std::list<SpanLog> spanLogs;
+        };
+
+        struct Trace {
+            boost::uuids::uuid traceId;
+            std::vector<BufferedSpan> spans;
+            bool error = false;
+            long maxDurationMillis = 0;
+        };
+
+        typedef std::unordered_map<boost::uuids::uuid, Trace, boost::hash<boost::uuids::uuid>> TraceTable;
+
+        // a slice of the traces, by trace ID, so that threads sending spans of different traces rarely contend
+        struct Shard {
+            std::mutex mutex;
+            TraceTable traces;
+            // pending traces in the order they were first seen, which is also the order of their decisions
+            std::deque<std::pair<boost::uuids::uuid, TimePoint>> pending;
+            size_t spans = 0;
+            // recent decisions, for spans that arrive late
+            std::unordered_map<boost::uuids::uuid, bool, boost::hash<boost::uuids::uuid>> decided;
+            std::deque<std::pair<boost::uuids::uuid, TimePoint>> decisions;
+        };
+
+        TailSamplingSender(Builder *builder);
+
+        void bufferSpan(const std::string &name, long startMillis, long durationMillis,
+                        const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                        const std::string &source, const std::list<boost::uuids::uuid> &parents,
+                        const std::list<boost::uuids::uuid> &followsFrom,
+                        const std::map<std::string, std::string> &tags, const std::list<SpanLog> &spanLogs);
+
+        Shard &shardOf(const boost::uuids::uuid &traceId);
+
+        /**
+        * Remove the oldest pending trace of the shard and decide it, under the shard's mutex. The decision is
+        * remembered for late spans of the trace.
+        */
+        Trace takeOldest(Shard &shard, TimePoint now, bool &kept);
+
+        // send a decided trace through the wrapped sender if it is kept
+        void release(Trace &trace, bool kept);
+
+        // send a span through the wrapped sender, with its span logs if it has any
+        void forward(const BufferedSpan &span, const boost::uuids::uuid &traceId);
+
+        // decide the traces whose wait has passed, or every pending trace
+        void decidePending(bool all);
+
+        void run();
+
+        WavefrontSender &sender;
+        std::chrono::milliseconds decisionWait;
+        size_t maxSpansPerShard;
+        long slowTraceMillis;
+        ProbabilisticSampler baseline;
+        std::vector<Shard> shards;
+
+        std::atomic<long> keptTraces;
+        std::atomic<long> droppedTraces;
+        std::atomic<long> evictedTraces;
+        std::atomic<long> droppedSpans;
+        std::atomic<long> bufferedSpans;
+
+        std::thread decider;
+        std::mutex deciderMutex;
+        std::condition_variable deciderCondition;
+        bool closed = false;
+    };
+}
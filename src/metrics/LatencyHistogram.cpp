@@ -0,0 +1,88 @@
+#include "metrics/LatencyHistogram.h"
+
+#include <algorithm>
+
+namespace wavefront {
+    const static double NANOS_PER_MICRO = 1e3;
+
+    // index of the bucket of a duration: the number of significant bits, capped at the last bucket
+    static int bucketOf(long nanos) {
+        int bits = 0;
+        while (nanos > 0 && bits < LatencyHistogram::BUCKETS - 1) {
+            nanos >>= 1;
+            bits++;
+        }
+        return bits;
+    }
+
+    // durations in bucket i are at least lowerBound(i) and less than lowerBound(i + 1)
+    static double lowerBound(int bucket) {
+        return bucket == 0 ? 0 : static_cast<double>(1L << (bucket - 1));
+    }
+
+    void LatencyHistogram::update(std::chrono::nanoseconds duration) {
+        long nanos = std::max(0L, static_cast<long>(duration.count()));
+        Cell &cell = cells.local();
+        cell.buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        cell.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+        long current = cell.maxNanos.load(std::memory_order_relaxed);
+        while (nanos > current && !cell.maxNanos.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    LatencyHistogram::Snapshot LatencyHistogram::snapshot() {
+        Snapshot snapshot;
+        cells.forEach([&snapshot](Cell &cell) {
+            for (int i = 0; i < BUCKETS; i++) {
+                long count = cell.buckets[i].load(std::memory_order_relaxed);
+                snapshot.buckets[i] += count;
+                snapshot.count += count;
+            }
+            snapshot.totalNanos += cell.totalNanos.load(std::memory_order_relaxed);
+            snapshot.maxNanos = std::max(snapshot.maxNanos, cell.maxNanos.load(std::memory_order_relaxed));
+        });
+        return snapshot;
+    }
+
+    double LatencyHistogram::Snapshot::meanMicros() const {
+        return count > 0 ? totalNanos / NANOS_PER_MICRO / count : 0;
+    }
+
+    double LatencyHistogram::Snapshot::percentileMicros(double fraction) const {
+        if (count == 0)
+            return 0;
+        double rank = std::min(std::max(fraction, 0.0), 1.0) * count;
+        long below = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            if (buckets[i] > 0 && below + buckets[i] >= rank) {
+                double lower = lowerBound(i);
+                double upper = std::min(lowerBound(i + 1), static_cast<double>(maxNanos));
+                double within = (rank - below) / buckets[i];
+                return (lower + std::max(0.0, upper - lower) * within) / NANOS_PER_MICRO;
+            }
+            below += buckets[i];
+        }
+        return maxNanos / NANOS_PER_MICRO;
+    }
+
+    double LatencyHistogram::Snapshot::maxMicros() const {
+        return maxNanos / NANOS_PER_MICRO;
+    }
+
+    LatencyHistogram::Snapshot LatencyHistogram::Snapshot::since(const Snapshot &earlier) const {
+        Snapshot difference;
+        int highest = -1;
+        for (int i = 0; i < BUCKETS; i++) {
+            difference.buckets[i] = buckets[i] - earlier.buckets[i];
+            difference.count += difference.buckets[i];
+            if (difference.buckets[i] > 0) {
+                highest = i;
+            }
+        }
+        difference.totalNanos = totalNanos - earlier.totalNanos;
+        if (highest >= 0) {
+            difference.maxNanos = std::min(maxNanos, static_cast<long>(lowerBound(highest + 1)));
+        }
+        return difference;
+    }
+}
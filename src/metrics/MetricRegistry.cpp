@@ -0,0 +1,229 @@
+#include "metrics/MetricRegistry.h"
+#include "common/Utils.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace wavefront {
+    const static char *TIMER_SUFFIXES[] = {".count", ".mean", ".min", ".max"};
+
+    MetricRegistry::MetricRegistry(MetricRegistry::Builder *builder)
+            : sender(builder->sender), reportingIntervalSeconds(builder->reportingIntervalSeconds),
+              source(builder->source), commonTags(builder->tags) {
+    }
+
+    MetricRegistry::~MetricRegistry() {
+        close();
+    }
+
+    std::shared_ptr<MetricRegistry::Entry> &MetricRegistry::lookup(const std::string &name, const Tags &tags, Kind kind) {
+        if (name.empty())
+            throw std::invalid_argument("metrics name cannot be blank");
+
+        Tags merged = tags;
+        merged.insert(commonTags.begin(), commonTags.end());
+        std::shared_ptr<const TagSet> tagSet = TagSet::intern(merged);
+        std::string key = name + '\n' + tagSet->getSerialized();
+
+        std::shared_ptr<Entry> &entry = entries[key];
+        if (entry != nullptr) {
+            bool gauges = (entry->kind == Kind::GAUGE || entry->kind == Kind::CALLBACK_GAUGE) &&
+                          (kind == Kind::GAUGE || kind == Kind::CALLBACK_GAUGE);
+            if (entry->kind != kind && !gauges)
+                throw std::invalid_argument("metric " + name + " is already registered as another kind");
+            return entry;
+        }
+
+        entry = std::make_shared<Entry>();
+        entry->kind = kind;
+        entry->name = name;
+        entry->tags = tagSet;
+        if (kind == Kind::DELTA_COUNTER) {
+            Utils::add_delta_prefix(entry->name);
+        } else if (kind == Kind::HISTOGRAM) {
+            // distributions are sent by name and tag set
+        } else if (kind == Kind::TIMER) {
+            for (const char *suffix : TIMER_SUFFIXES) {
+                entry->series.push_back(sender.registerSeries(name + suffix, source, merged));
+            }
+        } else {
+            entry->series.push_back(sender.registerSeries(name, source, merged));
+        }
+        return entry;
+    }
+
+    template<typename Metric>
+    std::shared_ptr<Metric> MetricRegistry::metric(const std::string &name, const Tags &tags, Kind kind) {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::shared_ptr<Entry> &entry = lookup(name, tags, kind);
+        if (entry->metric == nullptr) {
+            entry->metric = std::make_shared<Metric>();
+        }
+        return std::static_pointer_cast<Metric>(entry->metric);
+    }
+
+    std::shared_ptr<Counter> MetricRegistry::counter(const std::string &name, const Tags &tags) {
+        return metric<Counter>(name, tags, Kind::COUNTER);
+    }
+
+    std::shared_ptr<DeltaCounter> MetricRegistry::deltaCounter(const std::string &name, const Tags &tags) {
+        return metric<DeltaCounter>(name, tags, Kind::DELTA_COUNTER);
+    }
+
+    std::shared_ptr<Gauge> MetricRegistry::gauge(const std::string &name, const Tags &tags) {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::shared_ptr<Entry> &entry = lookup(name, tags, Kind::GAUGE);
+        if (entry->kind == Kind::CALLBACK_GAUGE) {
+            // a callback gauge becomes a plain one again
+            std::shared_ptr<Entry> replacement = std::make_shared<Entry>(*entry);
+            replacement->kind = Kind::GAUGE;
+            replacement->callback = nullptr;
+            entry = replacement;
+        }
+        if (entry->metric == nullptr) {
+            entry->metric = std::make_shared<Gauge>();
+        }
+        return std::static_pointer_cast<Gauge>(entry->metric);
+    }
+
+    std::shared_ptr<Timer> MetricRegistry::timer(const std::string &name, const Tags &tags) {
+        return metric<Timer>(name, tags, Kind::TIMER);
+    }
+
+    std::shared_ptr<WavefrontHistogram>
+    MetricRegistry::histogram(const std::string &name, const Tags &tags,
+                              const std::set<HistogramGranularity> &granularities) {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::shared_ptr<Entry> &entry = lookup(name, tags, Kind::HISTOGRAM);
+        if (entry->metric == nullptr) {
+            entry->metric = std::make_shared<WavefrontHistogram>(granularities);
+        }
+        return std::static_pointer_cast<WavefrontHistogram>(entry->metric);
+    }
+
+    void MetricRegistry::gauge(const std::string &name, std::function<double()> callback, const Tags &tags) {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::shared_ptr<Entry> &entry = lookup(name, tags, Kind::CALLBACK_GAUGE);
+        std::shared_ptr<Entry> replacement = std::make_shared<Entry>(*entry);
+        replacement->kind = Kind::CALLBACK_GAUGE;
+        replacement->metric = nullptr;
+        replacement->callback = std::move(callback);
+        entry = replacement;
+    }
+
+    void MetricRegistry::beforeReport(std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock{mutex};
+        reportCallbacks.push_back(std::move(callback));
+    }
+
+    void MetricRegistry::start() {
+        std::lock_guard<std::mutex> lock{reporterMutex};
+        if (is_running || closed)
+            return;
+        is_running = true;
+        reporter = std::thread(&MetricRegistry::run, this);
+    }
+
+    void MetricRegistry::report() {
+        report(false);
+    }
+
+    void MetricRegistry::report(bool closing) {
+        std::vector<std::shared_ptr<Entry>> snapshot;
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            callbacks = reportCallbacks;
+            snapshot.reserve(entries.size());
+            for (auto &element : entries) {
+                snapshot.push_back(element.second);
+            }
+        }
+        for (auto &callback : callbacks) {
+            try {
+                callback();
+            } catch (std::exception &e) {
+                std::cerr << "Error preparing report: " << e.what() << std::endl;
+            }
+        }
+        long timestamp = Utils::get_millis_from_epoch();
+        for (auto &entry : snapshot) {
+            try {
+                reportEntry(*entry, timestamp, closing);
+            } catch (std::exception &e) {
+                std::cerr << "Error reporting metric " << entry->name << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    void MetricRegistry::reportEntry(Entry &entry, long timestamp, bool closing) {
+        switch (entry.kind) {
+            case Kind::COUNTER:
+                sender.sendMetric(*entry.series[0], static_cast<Counter *>(entry.metric.get())->getCount(),
+                                  timestamp);
+                break;
+            case Kind::DELTA_COUNTER: {
+                long delta = static_cast<DeltaCounter *>(entry.metric.get())->getAndReset();
+                if (delta != 0) {
+                    // the name already carries the delta prefix, which the sender checks for
+                    std::string name = entry.name;
+                    sender.sendDeltaCounter(name, delta, source, *entry.tags);
+                }
+                break;
+            }
+            case Kind::GAUGE:
+                sender.sendMetric(*entry.series[0], static_cast<Gauge *>(entry.metric.get())->getValue(),
+                                  timestamp);
+                break;
+            case Kind::CALLBACK_GAUGE:
+                sender.sendMetric(*entry.series[0], entry.callback(), timestamp);
+                break;
+            case Kind::TIMER: {
+                Timer::Snapshot snapshot = static_cast<Timer *>(entry.metric.get())->getAndReset();
+                if (snapshot.count > 0) {
+                    sender.sendMetric(*entry.series[0], snapshot.count, timestamp);
+                    sender.sendMetric(*entry.series[1], snapshot.meanMillis, timestamp);
+                    sender.sendMetric(*entry.series[2], snapshot.minMillis, timestamp);
+                    sender.sendMetric(*entry.series[3], snapshot.maxMillis, timestamp);
+                }
+                break;
+            }
+            case Kind::HISTOGRAM: {
+                auto histogram = static_cast<WavefrontHistogram *>(entry.metric.get());
+                histogram->flush(timestamp, [this, &entry](HistogramGranularity granularity, long windowStart,
+                                                           const std::list<std::pair<double, int>> &centroids) {
+                    sender.sendDistribution(entry.name, centroids, {granularity}, windowStart, source, *entry.tags);
+                }, closing);
+                break;
+            }
+        }
+    }
+
+    void MetricRegistry::run() {
+        auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(reportingIntervalSeconds);
+        std::unique_lock<std::mutex> lock{reporterMutex};
+        while (is_running) {
+            if (reporterCondition.wait_until(lock, nextReport, [this] { return !is_running; }))
+                break;
+            lock.unlock();
+            report();
+            lock.lock();
+            nextReport += std::chrono::seconds(reportingIntervalSeconds);
+        }
+    }
+
+    void MetricRegistry::close() {
+        {
+            std::lock_guard<std::mutex> lock{reporterMutex};
+            if (closed)
+                return;
+            closed = true;
+            is_running = false;
+        }
+        reporterCondition.notify_all();
+        if (reporter.joinable()) {
+            reporter.join();
+        }
+        report(true);
+    }
+}
@@ -0,0 +1,102 @@
+#include "metrics/SdkMetrics.h"
+
+#include <memory>
+#include <mutex>
+
+#include "metrics/MetricRegistry.h"
+
+namespace wavefront {
+    SdkMetrics::SerializationTimer::SerializationTimer(SdkMetrics &metrics) : histogram(nullptr) {
+        static thread_local unsigned points = 0;
+        if (++points % SAMPLE_RATE == 0) {
+            histogram = &metrics.serialization;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    SdkMetrics::SerializationTimer::~SerializationTimer() {
+        if (histogram != nullptr) {
+            histogram->update(std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    SenderStats SdkMetrics::snapshot() {
+        SenderStats stats;
+        stats.pointsSent = pointsSent.getCount();
+        stats.pointsInvalid = pointsInvalid.getCount();
+        stats.pointsDropped = pointsDropped.getCount();
+        stats.bytesSerialized = bytesSerialized.getCount();
+        stats.reports = reports.getCount();
+        stats.reportErrors = reportErrors.getCount();
+        stats.bytesSent = bytesSent.getCount();
+        stats.compressedBytesIn = compressedBytesIn.getCount();
+        stats.compressedBytesOut = compressedBytesOut.getCount();
+        stats.serialization = serialization.snapshot();
+        stats.compression = compression.snapshot();
+        stats.report = report.snapshot();
+        return stats;
+    }
+
+    // the stats of the current report and the latencies since the previous one, shared by the gauges
+    struct ReportedStats {
+        std::mutex mutex;
+        SenderStats current;
+        LatencyHistogram::Snapshot latencies[3];
+    };
+
+    void SdkMetrics::registerGauges(MetricRegistry &registry, const std::string &prefix,
+                                    std::function<SenderStats()> stats) {
+        std::shared_ptr<ReportedStats> reported = std::make_shared<ReportedStats>();
+        registry.beforeReport([reported, stats] {
+            SenderStats current = stats();
+            std::lock_guard<std::mutex> lock{reported->mutex};
+            reported->latencies[0] = current.serialization.since(reported->current.serialization);
+            reported->latencies[1] = current.compression.since(reported->current.compression);
+            reported->latencies[2] = current.report.since(reported->current.report);
+            reported->current = std::move(current);
+        });
+
+        auto gauge = [&registry, &prefix, reported](const std::string &name,
+                                                    std::function<double(const SenderStats &)> value) {
+            registry.gauge(prefix + name, [reported, value] {
+                std::lock_guard<std::mutex> lock{reported->mutex};
+                return value(reported->current);
+            });
+        };
+        gauge("points.sent", [](const SenderStats &s) { return s.pointsSent; });
+        gauge("points.invalid", [](const SenderStats &s) { return s.pointsInvalid; });
+        gauge("points.dropped", [](const SenderStats &s) { return s.pointsDropped; });
+        gauge("bytes.serialized", [](const SenderStats &s) { return s.bytesSerialized; });
+        gauge("bytes.sent", [](const SenderStats &s) { return s.bytesSent; });
+        gauge("reports.count", [](const SenderStats &s) { return s.reports; });
+        gauge("reports.errors", [](const SenderStats &s) { return s.reportErrors; });
+        gauge("compression.ratio", [](const SenderStats &s) { return s.compressionRatio(); });
+        gauge("queue.points", [](const SenderStats &s) { return s.queuedPoints; });
+        gauge("queue.bytes", [](const SenderStats &s) { return s.queuedBytes; });
+
+        const char *stages[] = {"serialize", "compress", "report"};
+        for (int i = 0; i < 3; i++) {
+            std::string stage = prefix + "latency." + stages[i];
+            registry.gauge(stage + ".count", [reported, i] {
+                std::lock_guard<std::mutex> lock{reported->mutex};
+                return static_cast<double>(reported->latencies[i].count);
+            });
+            registry.gauge(stage + ".mean_micros", [reported, i] {
+                std::lock_guard<std::mutex> lock{reported->mutex};
+                return reported->latencies[i].meanMicros();
+            });
+            registry.gauge(stage + ".p50_micros", [reported, i] {
+                std::lock_guard<std::mutex> lock{reported->mutex};
+                return reported->latencies[i].percentileMicros(0.5);
+            });
+            registry.gauge(stage + ".p99_micros", [reported, i] {
+                std::lock_guard<std::mutex> lock{reported->mutex};
+                return reported->latencies[i].percentileMicros(0.99);
+            });
+            registry.gauge(stage + ".max_micros", [reported, i] {
+                std::lock_guard<std::mutex> lock{reported->mutex};
+                return reported->latencies[i].maxMicros();
+            });
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#include "metrics/Striped.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace wavefront {
+    static size_t computeCount() {
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        size_t count = 1;
+        while (count < cores && count < Stripes::MAX_STRIPES) {
+            count <<= 1;
+        }
+        return count;
+    }
+
+    size_t Stripes::count() {
+        static const size_t stripes = computeCount();
+        return stripes;
+    }
+
+    size_t Stripes::index() {
+        static const size_t mask = count() - 1;
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        if (cpu >= 0)
+            return static_cast<size_t>(cpu) & mask;
+#endif
+        // without the current core, spread threads over the stripes in the order they first get here
+        static std::atomic<size_t> nextThread(0);
+        static thread_local size_t threadStripe = nextThread.fetch_add(1);
+        return threadStripe & mask;
+    }
+}
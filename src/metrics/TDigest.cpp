@@ -0,0 +1,125 @@
+#include "metrics/TDigest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace wavefront {
+    // values buffered per unit of compression before a merge; larger buffers merge less often
+    const static int BUFFER_FACTOR = 5;
+
+    TDigest::TDigest(int compression) : compression(compression) {
+        if (compression < 10)
+            throw std::invalid_argument("t-digest compression must be at least 10");
+        // the k1 scale function spans compression / 2 units; merging greedily at most doubles that
+        maxCentroids = static_cast<size_t>(2 * compression);
+        centroids.resize(maxCentroids + BUFFER_FACTOR * static_cast<size_t>(compression));
+        previous.resize(maxCentroids);
+    }
+
+    void TDigest::add(double value, double weight) {
+        if (std::isnan(value) || weight <= 0)
+            return;
+        if (used == centroids.size()) {
+            compress();
+        }
+        centroids[used].mean = value;
+        centroids[used].weight = weight;
+        used++;
+        totalWeight += weight;
+    }
+
+    void TDigest::merge(TDigest &other) {
+        other.compress();
+        for (size_t i = 0; i < other.used; i++) {
+            add(other.centroids[i].mean, other.centroids[i].weight);
+        }
+    }
+
+    void TDigest::reset() {
+        merged = 0;
+        used = 0;
+        totalWeight = 0;
+    }
+
+    double TDigest::quantileLimit(double q) {
+        // k1 scale function: k(q) = compression / (2 pi) * asin(2q - 1), inverted at k(q) + 1
+        double k = compression / (2 * M_PI) * std::asin(2 * q - 1) + 1;
+        if (k >= compression / 4)
+            return 1;
+        return (std::sin(k * 2 * M_PI / compression) + 1) / 2;
+    }
+
+    void TDigest::compress() {
+        if (used == merged)
+            return;
+        // only the buffer needs sorting; the centroids are sorted already and are read from a copy, so that
+        // the merged output can overwrite them
+        auto byMean = [](const Centroid &a, const Centroid &b) {
+            return a.mean < b.mean;
+        };
+        std::sort(centroids.begin() + merged, centroids.begin() + used, byMean);
+        std::copy(centroids.begin(), centroids.begin() + merged, previous.begin());
+
+        // merge neighbours while the result stays within one unit of the scale function; the output never
+        // passes the buffered value being read
+        size_t fromPrevious = 0;
+        size_t fromBuffer = merged;
+        auto next = [&]() -> const Centroid & {
+            if (fromBuffer == used ||
+                (fromPrevious < merged && previous[fromPrevious].mean <= centroids[fromBuffer].mean))
+                return previous[fromPrevious++];
+            return centroids[fromBuffer++];
+        };
+        double weightSoFar = 0;
+        double weightLimit = totalWeight * quantileLimit(0);
+        size_t out = 0;
+        Centroid current = next();
+        for (size_t i = 1; i < used; i++) {
+            const Centroid &candidate = next();
+            double proposed = current.weight + candidate.weight;
+            if (weightSoFar + proposed <= weightLimit || out + 1 >= maxCentroids) {
+                current.mean += (candidate.mean - current.mean) * candidate.weight / proposed;
+                current.weight = proposed;
+            } else {
+                centroids[out++] = current;
+                weightSoFar += current.weight;
+                weightLimit = totalWeight * quantileLimit(weightSoFar / totalWeight);
+                current = candidate;
+            }
+        }
+        centroids[out++] = current;
+        merged = used = out;
+    }
+
+    double TDigest::quantile(double q) {
+        compress();
+        if (used == 0)
+            return std::numeric_limits<double>::quiet_NaN();
+        if (used == 1)
+            return centroids[0].mean;
+
+        // interpolate between the centres of neighbouring centroids
+        double target = std::min(1.0, std::max(0.0, q)) * totalWeight;
+        double weightSoFar = centroids[0].weight / 2;
+        if (target <= weightSoFar)
+            return centroids[0].mean;
+        for (size_t i = 1; i < used; i++) {
+            double step = (centroids[i - 1].weight + centroids[i].weight) / 2;
+            if (target <= weightSoFar + step) {
+                double fraction = (target - weightSoFar) / step;
+                return centroids[i - 1].mean + fraction * (centroids[i].mean - centroids[i - 1].mean);
+            }
+            weightSoFar += step;
+        }
+        return centroids[used - 1].mean;
+    }
+
+    void TDigest::getCentroids(std::list<std::pair<double, int>> &result) {
+        compress();
+        for (size_t i = 0; i < used; i++) {
+            result.emplace_back(centroids[i].mean, static_cast<int>(std::lround(centroids[i].weight)));
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#include "metrics/Timer.h"
+
+#include <algorithm>
+
+namespace wavefront {
+    const static double NANOS_PER_MILLI = 1e6;
+
+    void Timer::update(std::chrono::nanoseconds duration) {
+        long nanos = static_cast<long>(duration.count());
+        Cell &cell = cells.local();
+        cell.count.fetch_add(1, std::memory_order_relaxed);
+        cell.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+        long current = cell.minNanos.load(std::memory_order_relaxed);
+        while (nanos < current && !cell.minNanos.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+        }
+        current = cell.maxNanos.load(std::memory_order_relaxed);
+        while (nanos > current && !cell.maxNanos.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    Timer::Snapshot Timer::getAndReset() {
+        long count = 0;
+        long totalNanos = 0;
+        long minNanos = std::numeric_limits<long>::max();
+        long maxNanos = 0;
+        cells.forEach([&](Cell &cell) {
+            count += cell.count.exchange(0, std::memory_order_relaxed);
+            totalNanos += cell.totalNanos.exchange(0, std::memory_order_relaxed);
+            minNanos = std::min(minNanos, cell.minNanos.exchange(std::numeric_limits<long>::max(),
+                                                                 std::memory_order_relaxed));
+            maxNanos = std::max(maxNanos, cell.maxNanos.exchange(0, std::memory_order_relaxed));
+        });
+
+        Snapshot snapshot;
+        snapshot.count = count;
+        if (count > 0) {
+            snapshot.meanMillis = totalNanos / NANOS_PER_MILLI / count;
+            snapshot.minMillis = minNanos / NANOS_PER_MILLI;
+            snapshot.maxMillis = maxNanos / NANOS_PER_MILLI;
+        }
+        return snapshot;
+    }
+}
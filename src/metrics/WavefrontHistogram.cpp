@@ -0,0 +1,129 @@
+#include "metrics/WavefrontHistogram.h"
+#include "common/Utils.h"
+
+#include <thread>
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace wavefront {
+    const static long MINUTE_MILLIS = 60 * 1000;
+
+    WavefrontHistogram::WavefrontHistogram(const std::set<HistogramGranularity> &granularities, int compression)
+            : scratch(compression) {
+        for (size_t i = 0; i < Stripes::count(); i++) {
+            stripes.emplace_back(new Stripe(compression));
+        }
+        for (HistogramGranularity granularity : granularities) {
+            windows.emplace_back(granularity, compression);
+        }
+    }
+
+    // minute bucketing needs no more than millisecond precision, which the coarse clock gives at a fraction of
+    // the cost of a precise read
+    static long currentMillis() {
+#if defined(__linux__) && defined(CLOCK_REALTIME_COARSE)
+        timespec now;
+        if (clock_gettime(CLOCK_REALTIME_COARSE, &now) == 0)
+            return static_cast<long>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+#endif
+        return Utils::get_millis_from_epoch();
+    }
+
+    long WavefrontHistogram::windowMillis(HistogramGranularity granularity) {
+        switch (granularity) {
+            case HistogramGranularity::HOUR:
+                return 60 * MINUTE_MILLIS;
+            case HistogramGranularity::DAY:
+                return 24 * 60 * MINUTE_MILLIS;
+            default:
+                return MINUTE_MILLIS;
+        }
+    }
+
+    void WavefrontHistogram::update(double value) {
+        long millis = currentMillis();
+        long minute = millis - millis % MINUTE_MILLIS;
+        Stripe &stripe = *stripes[Stripes::index()];
+        while (stripe.lock.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (minute != stripe.currentMinute) {
+            if (stripe.previous.empty()) {
+                std::swap(stripe.current, stripe.previous);
+                stripe.previousMinute = stripe.currentMinute;
+            } else {
+                // the flusher is more than a minute behind, so the older minute takes these values too
+                stripe.previous.merge(stripe.current);
+                stripe.current.reset();
+            }
+            stripe.currentMinute = minute;
+        }
+        stripe.current.add(value);
+        stripe.lock.clear(std::memory_order_release);
+    }
+
+    void WavefrontHistogram::flush(long nowMillis, const Sink &sink, bool flushOpen) {
+        std::lock_guard<std::mutex> lock{flushMutex};
+        long nowMinute = nowMillis - nowMillis % MINUTE_MILLIS;
+        for (auto &element : stripes) {
+            Stripe &stripe = *element;
+            // take completed minutes by swapping in the empty scratch digest, so recording only waits for a swap
+            for (int pass = 0; pass < 2; pass++) {
+                long minute = 0;
+                bool taken = false;
+                while (stripe.lock.test_and_set(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                if (pass == 0 && !stripe.previous.empty()) {
+                    std::swap(stripe.previous, scratch);
+                    minute = stripe.previousMinute;
+                    taken = true;
+                } else if (pass == 1 && !stripe.current.empty() &&
+                           (stripe.currentMinute < nowMinute || flushOpen)) {
+                    std::swap(stripe.current, scratch);
+                    minute = stripe.currentMinute;
+                    taken = true;
+                }
+                stripe.lock.clear(std::memory_order_release);
+                if (taken) {
+                    collect(minute, scratch, sink);
+                    scratch.reset();
+                }
+            }
+        }
+
+        for (Window &window : windows) {
+            if (!window.digest.empty() &&
+                (window.startMillis + windowMillis(window.granularity) <= nowMillis || flushOpen)) {
+                emit(window.granularity, window.startMillis, window.digest, sink);
+                window.digest.reset();
+            }
+        }
+    }
+
+    void WavefrontHistogram::collect(long minuteMillis, TDigest &digest, const Sink &sink) {
+        for (Window &window : windows) {
+            long start = minuteMillis - minuteMillis % windowMillis(window.granularity);
+            if (window.digest.empty() || start == window.startMillis) {
+                window.startMillis = start;
+                window.digest.merge(digest);
+            } else if (start > window.startMillis) {
+                emit(window.granularity, window.startMillis, window.digest, sink);
+                window.digest.reset();
+                window.startMillis = start;
+                window.digest.merge(digest);
+            } else {
+                // recorded just before its window was handed out; send it on its own
+                emit(window.granularity, start, digest, sink);
+            }
+        }
+    }
+
+    void WavefrontHistogram::emit(HistogramGranularity granularity, long startMillis, TDigest &digest,
+                                  const Sink &sink) {
+        std::list<std::pair<double, int>> centroids;
+        digest.getCentroids(centroids);
+        sink(granularity, startMillis, centroids);
+    }
+}
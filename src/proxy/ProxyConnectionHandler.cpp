@@ -1,12 +1,26 @@
 #include "proxy/ProxyConnectionHandler.h"
 
+#include <iostream>
 #include <memory>
 
 namespace wavefront {
+    // lines are packed into chunks of this size, each chunk becomes one iovec of a gather write
+    const static size_t CHUNK_SIZE = 64 * 1024;
+    // chunks kept for reuse once written
+    const static size_t MAX_FREE_CHUNKS = 16;
+
     ProxyConnectionHandler::ProxyConnectionHandler(std::string &hostName, unsigned short port)
+            : ProxyConnectionHandler(hostName, port, 0) {
+    }
+
+    ProxyConnectionHandler::ProxyConnectionHandler(std::string &hostName, unsigned short port,
+                                                   size_t maxBufferedBytes)
             : hostName(hostName),
               port(port),
-              socket(new CommunicatingSocket()) {
+              socket(new CommunicatingSocket()),
+              bufferedBytes(0),
+              maxBufferedBytes(maxBufferedBytes),
+              failures(0) {
     }
 
     ProxyConnectionHandler::~ProxyConnectionHandler() {
@@ -30,25 +44,312 @@ namespace wavefront {
         if (socket == nullptr)
             throw SocketException("can't connect to a closed socket");
         socket->connect(hostName, port);
+        socket->applyOptions(options);
+    }
+
+    void ProxyConnectionHandler::setSocketOptions(const SocketOptions &options) {
+        std::lock_guard<std::mutex> lock{mutex};
+        this->options = options;
+    }
+
+    void ProxyConnectionHandler::setRetryPolicy(RetryPolicy *retryPolicy) {
+        std::lock_guard<std::mutex> lock{mutex};
+        this->retryPolicy = retryPolicy;
+    }
+
+    void ProxyConnectionHandler::setMetrics(SdkMetrics *metrics) {
+        std::lock_guard<std::mutex> lock{mutex};
+        this->metrics = metrics;
+    }
+
+    void ProxyConnectionHandler::reconnect() throw(SocketException) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (failedReconnects > 0 && std::chrono::steady_clock::now() < reconnectAt)
+                throw SocketException("waiting to reconnect to " + hostName + ":" + std::to_string(port));
+        }
+        // try to close socket first and then reconnect
+        close();
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            socket.reset(new CommunicatingSocket());
+        }
+        try {
+            connect();
+        } catch (SocketException &e) {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (retryPolicy != nullptr) {
+                reconnectAt = std::chrono::steady_clock::now() + retryPolicy->backoff(++failedReconnects);
+            }
+            throw;
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        failedReconnects = 0;
     }
 
     void ProxyConnectionHandler::sendData(std::string &lineData) {
+        sendData(lineData.data(), lineData.length());
+    }
+
+    void ProxyConnectionHandler::sendData(const char *data, size_t length, int points) {
         mutex.lock();
+        auto start = std::chrono::steady_clock::now();
         try {
-            socket->send(lineData.c_str(), lineData.length());
+            socket->send(data, length);
+            if (metrics != nullptr) {
+                metrics->report.update(std::chrono::steady_clock::now() - start);
+                metrics->reports.inc();
+                metrics->bytesSent.inc(static_cast<long>(length));
+                metrics->pointsSent.inc(points);
+            }
             mutex.unlock();
         } catch (SocketException e) {
+            if (metrics != nullptr) {
+                metrics->reports.inc();
+                metrics->reportErrors.inc();
+                metrics->pointsDropped.inc(points);
+            }
             mutex.unlock();
-            try {
-                // try to close socket first and then reconnect
-                close();
-                socket.reset(new CommunicatingSocket());
-                connect();
-            } catch (SocketException &e) {
-                throw e;
+            reconnect();
+        }
+    }
+
+    size_t ProxyConnectionHandler::bufferData(const char *data, size_t length, int points) {
+        std::lock_guard<std::mutex> lock{bufferMutex};
+        size_t buffered = bufferedBytes.load(std::memory_order_relaxed);
+        if (buffered + length > maxBufferedBytes) {
+            failures.fetch_add(1);
+            if (metrics != nullptr) {
+                metrics->pointsDropped.inc(points);
             }
+            return buffered;
         }
+        pendingPoints += points;
+        if (pendingChunks.empty() || pendingChunks.back()->size() + length > CHUNK_SIZE) {
+            if (freeChunks.empty()) {
+                pendingChunks.emplace_back(new OutputBuffer(CHUNK_SIZE));
+            } else {
+                pendingChunks.push_back(std::move(freeChunks.back()));
+                freeChunks.pop_back();
+            }
+        }
+        // a line longer than a chunk simply grows its chunk
+        pendingChunks.back()->append(data, length);
+        // the count also covers chunks still being written, which are released outside bufferMutex
+        return bufferedBytes.fetch_add(length) + length;
     }
 
+    long ProxyConnectionHandler::takePending(std::vector<std::unique_ptr<OutputBuffer>> &chunks) {
+        std::lock_guard<std::mutex> lock{bufferMutex};
+        chunks.swap(pendingChunks);
+        long points = pendingPoints;
+        pendingPoints = 0;
+        return points;
+    }
 
+    void ProxyConnectionHandler::recycle(std::vector<std::unique_ptr<OutputBuffer>> &chunks) {
+        size_t released = 0;
+        for (auto &chunk : chunks) {
+            released += chunk->size();
+        }
+        {
+            std::lock_guard<std::mutex> lock{bufferMutex};
+            for (auto &chunk : chunks) {
+                if (freeChunks.size() < MAX_FREE_CHUNKS) {
+                    chunk->clear();
+                    freeChunks.push_back(std::move(chunk));
+                }
+            }
+        }
+        bufferedBytes.fetch_sub(released);
+        chunks.clear();
+    }
+
+    void ProxyConnectionHandler::flushBuffer() {
+        // after a failed reconnect the data stays buffered until the next attempt succeeds
+        bool disconnected;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (failedReconnects > 0 && std::chrono::steady_clock::now() < reconnectAt)
+                return;
+            disconnected = failedReconnects > 0;
+        }
+        if (disconnected) {
+            reconnect();
+        }
+
+        std::vector<std::unique_ptr<OutputBuffer>> chunks;
+        long points = takePending(chunks);
+        if (chunks.empty())
+            return;
+
+        std::vector<iovec> buffers(chunks.size());
+        size_t length = 0;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            buffers[i].iov_base = const_cast<char *>(chunks[i]->data());
+            buffers[i].iov_len = chunks[i]->size();
+            length += chunks[i]->size();
+        }
+
+        bool sent = false;
+        bool closed = false;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (socket == nullptr) {
+                closed = true;
+                if (metrics != nullptr) {
+                    metrics->pointsDropped.inc(points);
+                }
+            } else {
+                auto start = std::chrono::steady_clock::now();
+                try {
+                    if (options.cork) {
+                        socket->setCork(true);
+                    }
+                    socket->sendv(buffers.data(), static_cast<int>(buffers.size()));
+                    if (options.cork) {
+                        socket->setCork(false);
+                    }
+                    sent = true;
+                } catch (SocketException &e) {
+                }
+                if (metrics != nullptr) {
+                    metrics->reports.inc();
+                    if (sent) {
+                        metrics->report.update(std::chrono::steady_clock::now() - start);
+                        metrics->bytesSent.inc(static_cast<long>(length));
+                        metrics->pointsSent.inc(points);
+                    } else {
+                        metrics->reportErrors.inc();
+                        metrics->pointsDropped.inc(points);
+                    }
+                }
+            }
+        }
+
+        recycle(chunks);
+
+        if (!sent) {
+            failures.fetch_add(1);
+            if (!closed) {
+                reconnect();
+            }
+        }
+    }
+
+    bool ProxyConnectionHandler::startConnect() throw(SocketException) {
+        std::lock_guard<std::mutex> lock{mutex};
+        socket.reset(new CommunicatingSocket());
+        socket->setNonBlocking(true);
+        socket->applyOptions(options);
+        return socket->connectNonBlocking(hostName, port);
+    }
+
+    void ProxyConnectionHandler::finishConnect() throw(SocketException) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (socket == nullptr)
+            throw SocketException("can't connect to a closed socket");
+        socket->finishConnect();
+    }
+
+    bool ProxyConnectionHandler::writeBuffered() throw(SocketException) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (socket == nullptr)
+            throw SocketException("can't write to a closed socket");
+
+        if (options.cork) {
+            socket->setCork(true);
+        }
+        while (true) {
+            if (writingIndex == writingBuffers.size()) {
+                if (metrics != nullptr) {
+                    metrics->pointsSent.inc(writingPoints);
+                }
+                recycle(writingChunks);
+                writingBuffers.clear();
+                writingIndex = 0;
+                writingPoints = takePending(writingChunks);
+                if (writingChunks.empty())
+                    break;
+                writingBuffers.resize(writingChunks.size());
+                for (size_t i = 0; i < writingChunks.size(); i++) {
+                    writingBuffers[i].iov_base = const_cast<char *>(writingChunks[i]->data());
+                    writingBuffers[i].iov_len = writingChunks[i]->size();
+                }
+            }
+            size_t unwritten = metrics != nullptr ? unwrittenBytes() : 0;
+            auto start = std::chrono::steady_clock::now();
+            writingIndex += socket->trySendv(&writingBuffers[writingIndex],
+                                             static_cast<int>(writingBuffers.size() - writingIndex));
+            if (metrics != nullptr) {
+                metrics->report.update(std::chrono::steady_clock::now() - start);
+                metrics->reports.inc();
+                metrics->bytesSent.inc(static_cast<long>(unwritten - unwrittenBytes()));
+            }
+            if (writingIndex < writingBuffers.size()) {
+                // socket buffer is full, stay corked until the rest is written
+                return false;
+            }
+        }
+        if (options.cork) {
+            socket->setCork(false);
+        }
+        return true;
+    }
+
+    size_t ProxyConnectionHandler::unwrittenBytes() {
+        size_t unwritten = 0;
+        for (size_t i = writingIndex; i < writingBuffers.size(); i++) {
+            unwritten += writingBuffers[i].iov_len;
+        }
+        return unwritten;
+    }
+
+    void ProxyConnectionHandler::dropConnection() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (metrics != nullptr) {
+                metrics->reportErrors.inc();
+                metrics->pointsDropped.inc(writingPoints);
+            }
+            if (socket != nullptr) {
+                try {
+                    socket->close();
+                } catch (SocketException &e) {
+                }
+                socket.reset(nullptr);
+            }
+        }
+        recycle(writingChunks);
+        writingBuffers.clear();
+        writingIndex = 0;
+        writingPoints = 0;
+        failures.fetch_add(1);
+    }
+
+    void ProxyConnectionHandler::dropBuffered() {
+        std::vector<std::unique_ptr<OutputBuffer>> chunks;
+        long points = takePending(chunks);
+        recycle(chunks);
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            points += writingPoints;
+            recycle(writingChunks);
+            writingBuffers.clear();
+            writingIndex = 0;
+            writingPoints = 0;
+            if (metrics != nullptr) {
+                metrics->pointsDropped.inc(points);
+            }
+        }
+        if (points > 0) {
+            std::cerr << "Dropping " << points << " points still buffered for " << hostName << ":" << port
+                      << " on close" << std::endl;
+        }
+    }
+
+    int ProxyConnectionHandler::getDescriptor() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return socket == nullptr ? -1 : socket->getDescriptor();
+    }
 }
@@ -0,0 +1,209 @@
+#include "proxy/ProxyEventLoop.h"
+
+#ifdef WAVEFRONT_HAVE_EPOLL
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace wavefront {
+    const static int MAX_EVENTS = 16;
+
+    ProxyEventLoop::ProxyEventLoop(const std::vector<ProxyConnectionHandler *> &handlers, int flushIntervalMillis,
+                                   RetryPolicy &retryPolicy)
+            : flushIntervalMillis(flushIntervalMillis), retryPolicy(retryPolicy), wakeupPending(false),
+              stopping(false) {
+        for (ProxyConnectionHandler *handler : handlers) {
+            Connection connection;
+            connection.handler = handler;
+            connections.push_back(connection);
+        }
+
+        if ((epollDescriptor = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+            throw SocketException("Event loop creation failed (epoll_create1())", true);
+        }
+        if ((wakeupDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+            ::close(epollDescriptor);
+            throw SocketException("Event loop creation failed (eventfd())", true);
+        }
+        // connections register themselves by address, the wakeup descriptor is the null entry
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeupDescriptor, &event) < 0) {
+            ::close(wakeupDescriptor);
+            ::close(epollDescriptor);
+            throw SocketException("Event loop creation failed (epoll_ctl())", true);
+        }
+    }
+
+    ProxyEventLoop::~ProxyEventLoop() {
+        if (loop.joinable()) {
+            stop(0);
+        }
+        ::close(wakeupDescriptor);
+        ::close(epollDescriptor);
+    }
+
+    void ProxyEventLoop::start() {
+        loop = std::thread(&ProxyEventLoop::run, this);
+    }
+
+    void ProxyEventLoop::requestFlush() {
+        if (!wakeupPending.exchange(true)) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(wakeupDescriptor, &one, sizeof(one));
+            (void) ignored;
+        }
+    }
+
+    void ProxyEventLoop::stop(int drainTimeoutMillis) {
+        if (!loop.joinable())
+            return;
+        drainDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(drainTimeoutMillis);
+        stopping.store(true);
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeupDescriptor, &one, sizeof(one));
+        (void) ignored;
+        loop.join();
+    }
+
+    void ProxyEventLoop::run() {
+        epoll_event events[MAX_EVENTS];
+        while (true) {
+            auto now = std::chrono::steady_clock::now();
+            for (Connection &connection : connections) {
+                if (connection.state == State::DISCONNECTED && now >= connection.retryAt) {
+                    connect(connection);
+                }
+                // a connection waiting for writability is resumed by its EPOLLOUT event
+                if (connection.state == State::CONNECTED && !connection.watchingWrite) {
+                    write(connection);
+                }
+            }
+            if (stopping.load() && (drained() || now >= drainDeadline))
+                break;
+
+            int count = epoll_wait(epollDescriptor, events, MAX_EVENTS, nextTimeoutMillis(now));
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << SocketException("Event loop failed (epoll_wait())", true).what() << std::endl;
+                break;
+            }
+            for (int i = 0; i < count; i++) {
+                if (events[i].data.ptr == nullptr) {
+                    uint64_t value;
+                    ssize_t ignored = ::read(wakeupDescriptor, &value, sizeof(value));
+                    (void) ignored;
+                    wakeupPending.store(false);
+                } else {
+                    handleEvent(*static_cast<Connection *>(events[i].data.ptr), events[i].events);
+                }
+            }
+        }
+    }
+
+    void ProxyEventLoop::connect(Connection &connection) {
+        try {
+            bool connected = connection.handler->startConnect();
+            connection.descriptor = connection.handler->getDescriptor();
+
+            epoll_event event;
+            event.events = EPOLLRDHUP | (connected ? 0u : static_cast<uint32_t>(EPOLLOUT));
+            event.data.ptr = &connection;
+            if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, connection.descriptor, &event) < 0) {
+                connection.descriptor = -1;
+                throw SocketException("Watching connection failed (epoll_ctl())", true);
+            }
+            connection.watchingWrite = !connected;
+            connection.state = connected ? State::CONNECTED : State::CONNECTING;
+            if (connected) {
+                connection.failedAttempts = 0;
+            }
+        } catch (SocketException &e) {
+            fail(connection);
+        }
+    }
+
+    void ProxyEventLoop::handleEvent(Connection &connection, uint32_t events) {
+        if (connection.state == State::CONNECTING) {
+            try {
+                connection.handler->finishConnect();
+                connection.state = State::CONNECTED;
+                connection.failedAttempts = 0;
+                watchWrite(connection, false);
+            } catch (SocketException &e) {
+                fail(connection);
+            }
+            return;
+        }
+        if (connection.state != State::CONNECTED)
+            return;
+        if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            // the proxy never sends anything, so a readable end means it went away
+            fail(connection);
+        } else if (events & EPOLLOUT) {
+            write(connection);
+        }
+    }
+
+    void ProxyEventLoop::write(Connection &connection) {
+        try {
+            watchWrite(connection, !connection.handler->writeBuffered());
+        } catch (SocketException &e) {
+            fail(connection);
+        }
+    }
+
+    void ProxyEventLoop::watchWrite(Connection &connection, bool watch) {
+        if (connection.watchingWrite == watch)
+            return;
+        epoll_event event;
+        event.events = EPOLLRDHUP | (watch ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.ptr = &connection;
+        if (epoll_ctl(epollDescriptor, EPOLL_CTL_MOD, connection.descriptor, &event) < 0) {
+            throw SocketException("Watching connection failed (epoll_ctl())", true);
+        }
+        connection.watchingWrite = watch;
+    }
+
+    void ProxyEventLoop::fail(Connection &connection) {
+        if (connection.descriptor >= 0) {
+            epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, connection.descriptor, nullptr);
+            connection.descriptor = -1;
+        }
+        connection.handler->dropConnection();
+        connection.state = State::DISCONNECTED;
+        connection.watchingWrite = false;
+        connection.retryAt = std::chrono::steady_clock::now() + retryPolicy.backoff(++connection.failedAttempts);
+    }
+
+    bool ProxyEventLoop::drained() {
+        for (Connection &connection : connections) {
+            if (connection.handler->getBufferedBytes() > 0)
+                return false;
+        }
+        return true;
+    }
+
+    int ProxyEventLoop::nextTimeoutMillis(std::chrono::steady_clock::time_point now) {
+        auto wakeAt = now + std::chrono::milliseconds(flushIntervalMillis);
+        for (Connection &connection : connections) {
+            if (connection.state == State::DISCONNECTED) {
+                wakeAt = std::min(wakeAt, connection.retryAt);
+            }
+        }
+        if (stopping.load()) {
+            wakeAt = std::min(wakeAt, drainDeadline);
+        }
+        // round up so the loop does not spin while less than a millisecond remains
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(wakeAt - now).count();
+        return micros <= 0 ? 0 : static_cast<int>((micros + 999) / 1000);
+    }
+}
+
+#endif
@@ -1,33 +1,116 @@
 #include "proxy/WavefrontProxyClient.h"
 #include "common/Serializer.h"
 #include "common/Constants.h"
+#include "common/Utils.h"
 
 #include <iostream>
-#include <boost/algorithm/string/predicate.hpp>
 
 namespace wavefront {
-    WavefrontProxyClient::WavefrontProxyClient(WavefrontProxyClient::Builder *builder) {
+    // how long close() waits for the event loop to write out buffered data
+    const static int CLOSE_TIMEOUT_MILLIS = 5000;
+    const static std::list<SpanLog> NO_SPAN_LOGS;
+    // batches are written or buffered in pieces of about this many bytes
+    const static size_t BATCH_ENTRY_BYTES = 64 * 1024;
+    const static std::string SDK_METRICS_PREFIX = "~sdk.cpp.proxy_sender.";
+
+    // scratch buffer of the calling thread for span logs, which embed the span line held in OutputBuffer::threadLocal
+    static OutputBuffer &spanLogBuffer() {
+        static thread_local OutputBuffer scratch(1024);
+        scratch.clear();
+        return scratch;
+    }
+
+    WavefrontProxyClient::WavefrontProxyClient(WavefrontProxyClient::Builder *builder)
+            : retryPolicy(builder->retryOptions), sampler(builder->sampler), asyncMode(builder->asyncMode),
+              flushThresholdBytes(builder->flushThresholdBytes),
+              flushIntervalMillis(builder->flushIntervalMillis), flushRequested(false), is_running(false) {
+        bool nonBlockingIO = builder->nonBlockingIO;
+#ifndef WAVEFRONT_HAVE_EPOLL
+        if (nonBlockingIO) {
+            std::cerr << "non-blocking I/O is not supported on this platform, using async mode" << std::endl;
+            nonBlockingIO = false;
+            asyncMode = true;
+        }
+#endif
         try {
             if (builder->distributionPort != 0) {
                 distributionHandler = std::unique_ptr<ProxyConnectionHandler>(
-                        new ProxyConnectionHandler(builder->hostName, builder->distributionPort));
-                distributionHandler->connect();
+                        new ProxyConnectionHandler(builder->hostName, builder->distributionPort,
+                                                   builder->maxBufferedBytes));
+                distributionHandler->setSocketOptions(builder->socketOptions);
+                distributionHandler->setRetryPolicy(&retryPolicy);
+                distributionHandler->setMetrics(&selfMetrics);
+                if (!nonBlockingIO)
+                    distributionHandler->connect();
             }
 
             if (builder->metricsPort != 0) {
                 metricHandler = std::unique_ptr<ProxyConnectionHandler>(
-                        new ProxyConnectionHandler(builder->hostName, builder->metricsPort));
-                metricHandler->connect();
+                        new ProxyConnectionHandler(builder->hostName, builder->metricsPort,
+                                                   builder->maxBufferedBytes));
+                metricHandler->setSocketOptions(builder->socketOptions);
+                metricHandler->setRetryPolicy(&retryPolicy);
+                metricHandler->setMetrics(&selfMetrics);
+                if (!nonBlockingIO)
+                    metricHandler->connect();
             }
 
             if (builder->tracingPort != 0) {
                 tracingHandler = std::unique_ptr<ProxyConnectionHandler>(
-                        new ProxyConnectionHandler(builder->hostName, builder->tracingPort));
-                tracingHandler->connect();
+                        new ProxyConnectionHandler(builder->hostName, builder->tracingPort,
+                                                   builder->maxBufferedBytes));
+                tracingHandler->setSocketOptions(builder->socketOptions);
+                tracingHandler->setRetryPolicy(&retryPolicy);
+                tracingHandler->setMetrics(&selfMetrics);
+                if (!nonBlockingIO)
+                    tracingHandler->connect();
             }
         } catch (SocketException &e) {
             std::cerr << e.what() << std::endl;
         }
+
+#ifdef WAVEFRONT_HAVE_EPOLL
+        if (nonBlockingIO) {
+            std::vector<ProxyConnectionHandler *> handlers;
+            for (ProxyConnectionHandler *handler : {metricHandler.get(), distributionHandler.get(),
+                                                    tracingHandler.get()}) {
+                if (handler != nullptr)
+                    handlers.push_back(handler);
+            }
+            asyncMode = true;
+            try {
+                eventLoop = std::unique_ptr<ProxyEventLoop>(
+                        new ProxyEventLoop(handlers, flushIntervalMillis, retryPolicy));
+                eventLoop->start();
+                startSdkMetrics(builder->sdkMetricsIntervalSeconds);
+                return;
+            } catch (SocketException &e) {
+                std::cerr << e.what() << std::endl;
+                // fall back to the writer thread with blocking connections
+                for (ProxyConnectionHandler *handler : handlers) {
+                    try {
+                        handler->connect();
+                    } catch (SocketException &e) {
+                        std::cerr << e.what() << std::endl;
+                    }
+                }
+            }
+        }
+#endif
+
+        if (asyncMode) {
+            is_running.store(true);
+            writer = std::thread(&WavefrontProxyClient::writeTask, this);
+        }
+        startSdkMetrics(builder->sdkMetricsIntervalSeconds);
+    }
+
+    void WavefrontProxyClient::startSdkMetrics(int reportingIntervalSeconds) {
+        if (reportingIntervalSeconds <= 0)
+            return;
+        sdkMetrics.reset(MetricRegistry::Builder(*this).setReportingInterval(reportingIntervalSeconds).build());
+        SdkMetrics::registerGauges(*sdkMetrics, SDK_METRICS_PREFIX, [this] { return getStats(); });
+        sdkMetrics->start();
     }
 
     int WavefrontProxyClient::getFailureCount() {
@@ -47,7 +130,104 @@ namespace wavefront {
         return result;
     }
 
+    SenderStats WavefrontProxyClient::getStats() {
+        SenderStats stats = selfMetrics.snapshot();
+        for (ProxyConnectionHandler *handler : {metricHandler.get(), distributionHandler.get(), tracingHandler.get()}) {
+            if (handler != nullptr) {
+                stats.queuedBytes += handler->getBufferedBytes();
+            }
+        }
+        return stats;
+    }
+
+    void WavefrontProxyClient::dispatch(ProxyConnectionHandler &handler, const OutputBuffer &lineData, int points) {
+        selfMetrics.bytesSerialized.inc(static_cast<long>(lineData.size()));
+        if (!asyncMode) {
+            handler.sendData(lineData.data(), lineData.size(), points);
+            return;
+        }
+        if (handler.bufferData(lineData.data(), lineData.size(), points) >= flushThresholdBytes) {
+            requestFlush();
+        }
+    }
+
+    void WavefrontProxyClient::dispatchBatch(ProxyConnectionHandler &handler, OutputBuffer &lineData, int points) {
+        try {
+            dispatch(handler, lineData, points);
+        } catch (SocketException &e) {
+            handler.incrementFailureCount();
+            std::cerr << e.what() << std::endl;
+        }
+        lineData.clear();
+    }
+
+    void WavefrontProxyClient::requestFlush() {
+#ifdef WAVEFRONT_HAVE_EPOLL
+        if (eventLoop != nullptr) {
+            eventLoop->requestFlush();
+            return;
+        }
+#endif
+        if (!flushRequested.exchange(true)) {
+            std::lock_guard<std::mutex> lock{writerMutex};
+            writerCondition.notify_one();
+        }
+    }
+
+    void WavefrontProxyClient::writeTask() {
+        std::unique_lock<std::mutex> lock{writerMutex};
+        while (is_running) {
+            writerCondition.wait_for(lock, std::chrono::milliseconds(flushIntervalMillis), [this] {
+                return flushRequested.load() || !is_running.load();
+            });
+            flushRequested.store(false);
+            lock.unlock();
+            flushBuffers();
+            lock.lock();
+        }
+    }
+
+    void WavefrontProxyClient::flushBuffers() {
+        for (ProxyConnectionHandler *handler : {metricHandler.get(), distributionHandler.get(), tracingHandler.get()}) {
+            if (handler == nullptr)
+                continue;
+            try {
+                handler->flushBuffer();
+            } catch (SocketException &e) {
+                handler->incrementFailureCount();
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+
     void WavefrontProxyClient::close() {
+        // the final report of the client's own stats goes out before the connections close
+        if (sdkMetrics != nullptr) {
+            sdkMetrics->close();
+        }
+#ifdef WAVEFRONT_HAVE_EPOLL
+        if (eventLoop != nullptr) {
+            eventLoop->stop(CLOSE_TIMEOUT_MILLIS);
+            eventLoop.reset(nullptr);
+        }
+#endif
+        if (asyncMode && is_running.load()) {
+            {
+                std::lock_guard<std::mutex> lock{writerMutex};
+                is_running.store(false);
+            }
+            writerCondition.notify_one();
+            writer.join();
+            // write whatever was buffered after the writer's last pass
+            flushBuffers();
+        }
+        // what the last writes could not deliver is lost with the connections
+        for (ProxyConnectionHandler *handler : {metricHandler.get(), distributionHandler.get(), tracingHandler.get()}) {
+            if (handler != nullptr) {
+                handler->dropBuffered();
+            }
+        }
+
         if (metricHandler != nullptr) {
             try {
                 metricHandler->close();
@@ -79,16 +259,87 @@ namespace wavefront {
     void
     WavefrontProxyClient::sendMetric(const std::string &name, double value, long timestamp, const std::string &source,
                                      std::map<std::string, std::string> tags) {
+        sendMetricLine(name, value, timestamp, source, tags);
+    }
+
+    void
+    WavefrontProxyClient::sendMetric(const std::string &name, double value, long timestamp, const std::string &source,
+                                     const TagSet &tags) {
+        sendMetricLine(name, value, timestamp, source, tags);
+    }
+
+    template<typename Tags>
+    void WavefrontProxyClient::sendMetricLine(boost::string_view name, double value, long timestamp,
+                                              boost::string_view source, const Tags &tags) {
         if (metricHandler == nullptr)
             return;
         try {
-            std::string lineData = Serializer::metricsToLineData(name, value, timestamp,
-                                                                 (source.empty() ? defaultSource : source), tags);
-            metricHandler->sendData(lineData);
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendMetric(lineData, name, value, timestamp,
+                                         (source.empty() ? boost::string_view(defaultSource) : source), tags);
+            }
+            dispatch(*metricHandler, lineData);
         } catch (SocketException &e) {
             metricHandler->incrementFailureCount();
             std::cerr << e.what() << std::endl;
         } catch (std::invalid_argument &e) {
+            metricHandler->incrementFailureCount();
+            selfMetrics.pointsInvalid.inc();
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void WavefrontProxyClient::sendMetrics(const std::vector<MetricPoint> &metrics) {
+        if (metricHandler == nullptr)
+            return;
+        OutputBuffer &lineData = OutputBuffer::threadLocal();
+        int points = 0;
+        for (auto &metric : metrics) {
+            try {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                const std::string &source = metric.source.empty() ? defaultSource : metric.source;
+                if (metric.tagSet != nullptr) {
+                    Serializer::appendMetric(lineData, metric.name, metric.value, metric.timestamp, source,
+                                             *metric.tagSet);
+                } else {
+                    Serializer::appendMetric(lineData, metric.name, metric.value, metric.timestamp, source,
+                                             metric.tags);
+                }
+                points++;
+            } catch (std::invalid_argument &e) {
+                metricHandler->incrementFailureCount();
+                selfMetrics.pointsInvalid.inc();
+                std::cerr << e.what() << std::endl;
+            }
+            if (lineData.size() >= BATCH_ENTRY_BYTES) {
+                dispatchBatch(*metricHandler, lineData, points);
+                points = 0;
+            }
+        }
+        if (!lineData.empty()) {
+            dispatchBatch(*metricHandler, lineData, points);
+        }
+    }
+
+    std::shared_ptr<const MetricSeries>
+    WavefrontProxyClient::registerSeries(const std::string &name, const std::string &source,
+                                         const std::map<std::string, std::string> &tags) {
+        return MetricSeries::create(name, (source.empty() ? defaultSource : source), tags);
+    }
+
+    void WavefrontProxyClient::sendMetric(const MetricSeries &series, double value, long timestamp) {
+        if (metricHandler == nullptr)
+            return;
+        try {
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendMetric(lineData, series, value, timestamp);
+            }
+            dispatch(*metricHandler, lineData);
+        } catch (SocketException &e) {
             metricHandler->incrementFailureCount();
             std::cerr << e.what() << std::endl;
         }
@@ -96,27 +347,50 @@ namespace wavefront {
 
     void WavefrontProxyClient::sendDeltaCounter(std::string &name, double value, const std::string &source,
                                                 std::map<std::string, std::string> tags) {
-        if (!boost::starts_with(name, constant::DELTA_PREFIX) && !boost::starts_with(name, constant::DELTA_PREFIX_2)) {
-            name += constant::DELTA_PREFIX;
-        }
-        sendMetric(name, value, -1, source, tags);
+        Utils::add_delta_prefix(name);
+        sendMetricLine(name, value, -1, source, tags);
+    }
+
+    void WavefrontProxyClient::sendDeltaCounter(std::string &name, double value, const std::string &source,
+                                                const TagSet &tags) {
+        Utils::add_delta_prefix(name);
+        sendMetricLine(name, value, -1, source, tags);
     }
 
     void WavefrontProxyClient::sendDistribution(const std::string &name, std::list<std::pair<double, int>> centroids,
                                                 std::set<wavefront::HistogramGranularity> histogramGranularities,
                                                 long timestamp,
                                                 const std::string &source, std::map<std::string, std::string> tags) {
+        sendDistributionLine(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    void WavefrontProxyClient::sendDistribution(const std::string &name,
+                                                const std::list<std::pair<double, int>> &centroids,
+                                                const std::set<HistogramGranularity> &histogramGranularities,
+                                                long timestamp, const std::string &source, const TagSet &tags) {
+        sendDistributionLine(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    template<typename Centroids, typename Granularities, typename Tags>
+    void WavefrontProxyClient::sendDistributionLine(boost::string_view name, const Centroids &centroids,
+                                                    const Granularities &histogramGranularities, long timestamp,
+                                                    boost::string_view source, const Tags &tags) {
         if (distributionHandler == nullptr)
             return;
         try {
-            std::string lineData = Serializer::histogramToLineData(name, centroids, histogramGranularities, timestamp,
-                                                                   (source.empty() ? defaultSource : source), tags);
-            distributionHandler->sendData(lineData);
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendHistogram(lineData, name, centroids, histogramGranularities, timestamp,
+                                            (source.empty() ? boost::string_view(defaultSource) : source), tags);
+            }
+            dispatch(*distributionHandler, lineData);
         } catch (SocketException &e) {
             distributionHandler->incrementFailureCount();
             std::cerr << e.what() << std::endl;
         } catch (std::invalid_argument &e) {
             distributionHandler->incrementFailureCount();
+            selfMetrics.pointsInvalid.inc();
             std::cerr << e.what() << std::endl;
         }
     }
@@ -127,22 +401,140 @@ namespace wavefront {
                                         std::list<boost::uuids::uuid> parents,
                                         std::list<boost::uuids::uuid> followsFrom,
                                         std::map<std::string, std::string> tags) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     NO_SPAN_LOGS);
+    }
+
+    void WavefrontProxyClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                        boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                        const std::string &source,
+                                        const std::list<boost::uuids::uuid> &parents,
+                                        const std::list<boost::uuids::uuid> &followsFrom,
+                                        const TagSet &tags) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     NO_SPAN_LOGS);
+    }
+
+    void WavefrontProxyClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                        boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                        const std::string &source,
+                                        const std::list<boost::uuids::uuid> &parents,
+                                        const std::list<boost::uuids::uuid> &followsFrom,
+                                        const std::map<std::string, std::string> &tags,
+                                        const std::list<SpanLog> &spanLogs) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     spanLogs);
+    }
+
+    void WavefrontProxyClient::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                        boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                        const std::string &source,
+                                        const std::list<boost::uuids::uuid> &parents,
+                                        const std::list<boost::uuids::uuid> &followsFrom,
+                                        const TagSet &tags, const std::list<SpanLog> &spanLogs) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     spanLogs);
+    }
+
+    void WavefrontProxyClient::sendMetric(boost::string_view name, double value, long timestamp,
+                                          boost::string_view source, ArrayView<TagView> tags) {
+        sendMetricLine(name, value, timestamp, source, tags);
+    }
+
+    void WavefrontProxyClient::sendDistribution(boost::string_view name,
+                                                ArrayView<std::pair<double, int>> centroids,
+                                                ArrayView<HistogramGranularity> histogramGranularities,
+                                                long timestamp, boost::string_view source,
+                                                ArrayView<TagView> tags) {
+        sendDistributionLine(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    void WavefrontProxyClient::sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                                        const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                                        boost::string_view source, ArrayView<boost::uuids::uuid> parents,
+                                        ArrayView<boost::uuids::uuid> followsFrom, ArrayView<TagView> tags) {
+        sendSpanLine(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags,
+                     NO_SPAN_LOGS);
+    }
+
+    void WavefrontProxyClient::sendSpans(const std::vector<SpanPoint> &spans) {
+        if (tracingHandler == nullptr)
+            return;
+        OutputBuffer &lineData = OutputBuffer::threadLocal();
+        OutputBuffer &logData = spanLogBuffer();
+        int points = 0;
+        for (auto &span : spans) {
+            if (sampler != nullptr && !sampler->sample(span.name, span.traceId, span.durationMillis))
+                continue;
+            try {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                size_t start = lineData.size();
+                const std::string &source = span.source.empty() ? defaultSource : span.source;
+                if (span.tagSet != nullptr) {
+                    Serializer::appendSpan(lineData, span.name, span.startMillis, span.durationMillis, span.traceId,
+                                           span.spanId, source, span.parents, span.followsFrom, *span.tagSet,
+                                           !span.spanLogs.empty());
+                } else {
+                    Serializer::appendSpan(lineData, span.name, span.startMillis, span.durationMillis, span.traceId,
+                                           span.spanId, source, span.parents, span.followsFrom, span.tags,
+                                           !span.spanLogs.empty());
+                }
+                points++;
+                if (!span.spanLogs.empty()) {
+                    Serializer::appendSpanLogs(logData, span.traceId, span.spanId, span.spanLogs,
+                                               lineData.data() + start, lineData.size() - start - 1);
+                    lineData.append(logData.data(), logData.size());
+                    logData.clear();
+                    points++;
+                }
+            } catch (std::invalid_argument &e) {
+                tracingHandler->incrementFailureCount();
+                selfMetrics.pointsInvalid.inc();
+                std::cerr << e.what() << std::endl;
+            }
+            if (lineData.size() >= BATCH_ENTRY_BYTES) {
+                dispatchBatch(*tracingHandler, lineData, points);
+                points = 0;
+            }
+        }
+        if (!lineData.empty()) {
+            dispatchBatch(*tracingHandler, lineData, points);
+        }
+    }
+
+    template<typename Ids, typename Tags>
+    void WavefrontProxyClient::sendSpanLine(boost::string_view name, long startMillis, long durationMillis,
+                                            const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                                            boost::string_view source, const Ids &parents, const Ids &followsFrom,
+                                            const Tags &tags, const std::list<SpanLog> &spanLogs) {
         if (tracingHandler == nullptr)
             return;
+        if (sampler != nullptr && !sampler->sample(name, traceId, durationMillis))
+            return;
 
         try {
-            std::string lineData = Serializer::spanToLineData(name, startMillis, durationMillis, traceId, spanId,
-                                                              (source.empty() ? defaultSource : source), parents,
-                                                              followsFrom, tags);
-            tracingHandler->sendData(lineData);
+            OutputBuffer &lineData = OutputBuffer::threadLocal();
+            {
+                SdkMetrics::SerializationTimer timer(selfMetrics);
+                Serializer::appendSpan(lineData, name, startMillis, durationMillis, traceId, spanId,
+                                       (source.empty() ? boost::string_view(defaultSource) : source), parents,
+                                       followsFrom, tags, !spanLogs.empty());
+            }
+            dispatch(*tracingHandler, lineData);
+            if (!spanLogs.empty()) {
+                // the proxy takes span logs on the tracing port
+                OutputBuffer &logData = spanLogBuffer();
+                Serializer::appendSpanLogs(logData, traceId, spanId, spanLogs, lineData.data(), lineData.size() - 1);
+                dispatch(*tracingHandler, logData);
+            }
         } catch (SocketException &e) {
             tracingHandler->incrementFailureCount();
             std::cerr << e.what() << std::endl;
         } catch (std::invalid_argument &e) {
             tracingHandler->incrementFailureCount();
+            selfMetrics.pointsInvalid.inc();
             std::cerr << e.what() << std::endl;
         }
     }
 
-
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include "sampling/CompositeSampler.h"
+
+namespace wavefront {
+    CompositeSampler::CompositeSampler(std::vector<std::shared_ptr<Sampler>> samplers)
+            : samplers(std::move(samplers)) {
+    }
+
+    bool CompositeSampler::sample(boost::string_view operationName, const boost::uuids::uuid &traceId,
+                                  long durationMillis) {
+        for (auto &sampler : samplers) {
+            if (sampler->sample(operationName, traceId, durationMillis))
+                return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,25 @@
+#include "sampling/ProbabilisticSampler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace wavefront {
+    // resolution of the sampling rate
+    const static long MOD_FACTOR = 10000;
+
+    ProbabilisticSampler::ProbabilisticSampler(double samplingRate) {
+        samplingRate = std::min(1.0, std::max(0.0, samplingRate));
+        boundary = samplingRate > 0 ? static_cast<long>(samplingRate * MOD_FACTOR) : -1;
+    }
+
+    bool ProbabilisticSampler::sample(boost::string_view /*operationName*/, const boost::uuids::uuid &traceId,
+                                      long /*durationMillis*/) {
+        // the least significant 64 bits of the trace ID, read as the signed long the Java SDK hashes
+        uint64_t bits = 0;
+        for (size_t i = 8; i < 16; i++) {
+            bits = (bits << 8) | traceId.data[i];
+        }
+        long long hash = static_cast<long long>(bits) % MOD_FACTOR;
+        return (hash < 0 ? -hash : hash) <= boundary;
+    }
+}
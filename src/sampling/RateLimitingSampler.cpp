@@ -0,0 +1,33 @@
+#include "sampling/RateLimitingSampler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace wavefront {
+    static long long nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    RateLimitingSampler::RateLimitingSampler(double spansPerSecond, double burst) : fullAt(0) {
+        // a rate of 0 never earns a token
+        interval = spansPerSecond > 0 ? static_cast<long long>(1e9 / spansPerSecond) : -1;
+        capacity = interval > 0 ? static_cast<long long>(interval * std::max(1.0, burst)) : 0;
+    }
+
+    bool RateLimitingSampler::sample(boost::string_view /*operationName*/, const boost::uuids::uuid &/*traceId*/,
+                                     long /*durationMillis*/) {
+        if (interval < 0)
+            return false;
+        long long now = nowNanos();
+        long long current = fullAt.load(std::memory_order_relaxed);
+        while (true) {
+            // a bucket that filled up in the past holds no more than its capacity
+            long long next = std::max(current, now) + interval;
+            if (next - now > capacity)
+                return false;
+            if (fullAt.compare_exchange_weak(current, next, std::memory_order_relaxed))
+                return true;
+        }
+    }
+}
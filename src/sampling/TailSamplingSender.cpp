@@ -0,0 +1,281 @@
+#include "sampling/TailSamplingSender.h"
+
+#include <algorithm>
+
+namespace wavefront {
+    // traces are spread over this many independently locked shards
+    const static size_t SHARD_COUNT = 16;
+
+    TailSamplingSender::TailSamplingSender(TailSamplingSender::Builder *builder)
+            : sender(builder->sender), decisionWait(std::max(0, builder->decisionWaitMillis)),
+              maxSpansPerShard(std::max(static_cast<size_t>(1), builder->maxBufferedSpans / SHARD_COUNT)),
+              slowTraceMillis(builder->slowTraceMillis), baseline(builder->baselineRate), shards(SHARD_COUNT),
+              keptTraces(0), droppedTraces(0), evictedTraces(0), droppedSpans(0), bufferedSpans(0) {
+        decider = std::thread(&TailSamplingSender::run, this);
+    }
+
+    TailSamplingSender::~TailSamplingSender() {
+        close();
+    }
+
+    void TailSamplingSender::sendMetric(const std::string &name, double value, long timestamp,
+                                        const std::string &source, std::map<std::string, std::string> tags) {
+        sender.sendMetric(name, value, timestamp, source, tags);
+    }
+
+    void TailSamplingSender::sendMetric(const std::string &name, double value, long timestamp,
+                                        const std::string &source, const TagSet &tags) {
+        sender.sendMetric(name, value, timestamp, source, tags);
+    }
+
+    std::shared_ptr<const MetricSeries>
+    TailSamplingSender::registerSeries(const std::string &name, const std::string &source,
+                                       const std::map<std::string, std::string> &tags) {
+        return sender.registerSeries(name, source, tags);
+    }
+
+    void TailSamplingSender::sendMetric(const MetricSeries &series, double value, long timestamp) {
+        sender.sendMetric(series, value, timestamp);
+    }
+
+    void TailSamplingSender::sendMetrics(const std::vector<MetricPoint> &metrics) {
+        sender.sendMetrics(metrics);
+    }
+
+    void TailSamplingSender::sendDeltaCounter(std::string &name, double value, const std::string &source,
+                                              std::map<std::string, std::string> tags) {
+        sender.sendDeltaCounter(name, value, source, tags);
+    }
+
+    void TailSamplingSender::sendDeltaCounter(std::string &name, double value, const std::string &source,
+                                              const TagSet &tags) {
+        sender.sendDeltaCounter(name, value, source, tags);
+    }
+
+    void TailSamplingSender::sendDistribution(const std::string &name, std::list<std::pair<double, int>> centroids,
+                                              std::set<HistogramGranularity> histogramGranularities,
+                                              long timestamp, const std::string &source,
+                                              std::map<std::string, std::string> tags) {
+        sender.sendDistribution(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    void TailSamplingSender::sendDistribution(const std::string &name,
+                                              const std::list<std::pair<double, int>> &centroids,
+                                              const std::set<HistogramGranularity> &histogramGranularities,
+                                              long timestamp, const std::string &source, const TagSet &tags) {
+        sender.sendDistribution(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    void TailSamplingSender::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                      boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                      const std::string &source, std::list<boost::uuids::uuid> parents,
+                                      std::list<boost::uuids::uuid> followsFrom,
+                                      std::map<std::string, std::string> tags) {
+        bufferSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags, {});
+    }
+
+    void TailSamplingSender::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                      boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                      const std::string &source, const std::list<boost::uuids::uuid> &parents,
+                                      const std::list<boost::uuids::uuid> &followsFrom, const TagSet &tags) {
+        bufferSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom,
+                   tags.getTags(), {});
+    }
+
+    void TailSamplingSender::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                      boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                      const std::string &source, const std::list<boost::uuids::uuid> &parents,
+                                      const std::list<boost::uuids::uuid> &followsFrom,
+                                      const std::map<std::string, std::string> &tags,
+                                      const std::list<SpanLog> &spanLogs) {
+        bufferSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom, tags, spanLogs);
+    }
+
+    void TailSamplingSender::sendSpan(const std::string &name, long startMillis, long durationMillis,
+                                      boost::uuids::uuid traceId, boost::uuids::uuid spanId,
+                                      const std::string &source, const std::list<boost::uuids::uuid> &parents,
+                                      const std::list<boost::uuids::uuid> &followsFrom, const TagSet &tags,
+                                      const std::list<SpanLog> &spanLogs) {
+        bufferSpan(name, startMillis, durationMillis, traceId, spanId, source, parents, followsFrom,
+                   tags.getTags(), spanLogs);
+    }
+
+    void TailSamplingSender::sendMetric(boost::string_view name, double value, long timestamp,
+                                        boost::string_view source, ArrayView<TagView> tags) {
+        sender.sendMetric(name, value, timestamp, source, tags);
+    }
+
+    void TailSamplingSender::sendDistribution(boost::string_view name, ArrayView<std::pair<double, int>> centroids,
+                                              ArrayView<HistogramGranularity> histogramGranularities,
+                                              long timestamp, boost::string_view source, ArrayView<TagView> tags) {
+        sender.sendDistribution(name, centroids, histogramGranularities, timestamp, source, tags);
+    }
+
+    // buffered spans own their fields, so the views are copied here
+    void TailSamplingSender::sendSpan(boost::string_view name, long startMillis, long durationMillis,
+                                      const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                                      boost::string_view source, ArrayView<boost::uuids::uuid> parents,
+                                      ArrayView<boost::uuids::uuid> followsFrom, ArrayView<TagView> tags) {
+        bufferSpan(std::string(name), startMillis, durationMillis, traceId, spanId, std::string(source),
+                   std::list<boost::uuids::uuid>(parents.begin(), parents.end()),
+                   std::list<boost::uuids::uuid>(followsFrom.begin(), followsFrom.end()), toTagMap(tags), {});
+    }
+
+    void TailSamplingSender::bufferSpan(const std::string &name, long startMillis, long durationMillis,
+                                        const boost::uuids::uuid &traceId, const boost::uuids::uuid &spanId,
+                                        const std::string &source, const std::list<boost::uuids::uuid> &parents,
+                                        const std::list<boost::uuids::uuid> &followsFrom,
+                                        const std::map<std::string, std::string> &tags,
+                                        const std::list<SpanLog> &spanLogs) {
+        Shard &shard = shardOf(traceId);
+        TimePoint now = std::chrono::steady_clock::now();
+        BufferedSpan span{name, startMillis, durationMillis, spanId, source, parents, followsFrom, tags, spanLogs};
+        bool late = false;
+        std::vector<std::pair<Trace, bool>> evicted;
+        {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            auto decision = shard.decided.find(traceId);
+            if (decision != shard.decided.end()) {
+                if (!decision->second) {
+                    droppedSpans.fetch_add(1);
+                    return;
+                }
+                late = true;
+            } else {
+                auto found = shard.traces.find(traceId);
+                if (found == shard.traces.end()) {
+                    found = shard.traces.emplace(traceId, Trace()).first;
+                    found->second.traceId = traceId;
+                    shard.pending.emplace_back(traceId, now + decisionWait);
+                }
+                Trace &trace = found->second;
+                trace.spans.push_back(std::move(span));
+                auto error = tags.find("error");
+                trace.error = trace.error || (error != tags.end() && error->second == "true");
+                trace.maxDurationMillis = std::max(trace.maxDurationMillis, durationMillis);
+                shard.spans++;
+                bufferedSpans.fetch_add(1);
+
+                while (shard.spans > maxSpansPerShard) {
+                    bool kept;
+                    Trace oldest = takeOldest(shard, now, kept);
+                    evicted.emplace_back(std::move(oldest), kept);
+                }
+            }
+        }
+        // a late span of a kept trace goes out right away
+        if (late) {
+            forward(span, traceId);
+            return;
+        }
+        evictedTraces.fetch_add(static_cast<long>(evicted.size()));
+        for (auto &entry : evicted) {
+            release(entry.first, entry.second);
+        }
+    }
+
+    TailSamplingSender::Shard &TailSamplingSender::shardOf(const boost::uuids::uuid &traceId) {
+        return shards[boost::hash<boost::uuids::uuid>()(traceId) % SHARD_COUNT];
+    }
+
+    TailSamplingSender::Trace TailSamplingSender::takeOldest(Shard &shard, TimePoint now, bool &kept) {
+        boost::uuids::uuid traceId = shard.pending.front().first;
+        shard.pending.pop_front();
+        auto found = shard.traces.find(traceId);
+        Trace trace = std::move(found->second);
+        shard.traces.erase(found);
+        shard.spans -= trace.spans.size();
+        bufferedSpans.fetch_sub(static_cast<long>(trace.spans.size()));
+
+        kept = trace.error || (slowTraceMillis > 0 && trace.maxDurationMillis >= slowTraceMillis) ||
+               baseline.sample("", traceId, trace.maxDurationMillis);
+
+        // remember the decision for late spans, no longer than the wait and for no more traces than spans
+        while (!shard.decisions.empty() &&
+               (shard.decisions.front().second <= now || shard.decisions.size() >= maxSpansPerShard)) {
+            shard.decided.erase(shard.decisions.front().first);
+            shard.decisions.pop_front();
+        }
+        shard.decided[traceId] = kept;
+        shard.decisions.emplace_back(traceId, now + decisionWait);
+        return trace;
+    }
+
+    void TailSamplingSender::release(Trace &trace, bool kept) {
+        if (!kept) {
+            droppedTraces.fetch_add(1);
+            droppedSpans.fetch_add(static_cast<long>(trace.spans.size()));
+            return;
+        }
+        keptTraces.fetch_add(1);
+        for (BufferedSpan &span : trace.spans) {
+            forward(span, trace.traceId);
+        }
+    }
+
+    void TailSamplingSender::forward(const BufferedSpan &span, const boost::uuids::uuid &traceId) {
+        if (span.spanLogs.empty()) {
+            sender.sendSpan(span.name, span.startMillis, span.durationMillis, traceId, span.spanId, span.source,
+                            span.parents, span.followsFrom, span.tags);
+        } else {
+            sender.sendSpan(span.name, span.startMillis, span.durationMillis, traceId, span.spanId, span.source,
+                            span.parents, span.followsFrom, span.tags, span.spanLogs);
+        }
+    }
+
+    void TailSamplingSender::decidePending(bool all) {
+        std::vector<std::pair<Trace, bool>> decided;
+        for (Shard &shard : shards) {
+            {
+                TimePoint now = std::chrono::steady_clock::now();
+                std::lock_guard<std::mutex> lock{shard.mutex};
+                while (!shard.pending.empty() && (all || shard.pending.front().second <= now)) {
+                    bool kept;
+                    Trace trace = takeOldest(shard, now, kept);
+                    decided.emplace_back(std::move(trace), kept);
+                }
+            }
+            // traces are sent without holding the shard, so that sending threads are not held up
+            for (auto &entry : decided) {
+                release(entry.first, entry.second);
+            }
+            decided.clear();
+        }
+    }
+
+    void TailSamplingSender::run() {
+        // decide traces within a fraction of the wait after it has passed
+        auto tick = std::min(std::chrono::milliseconds(1000),
+                             std::max(std::chrono::milliseconds(10), decisionWait / 4));
+        std::unique_lock<std::mutex> lock{deciderMutex};
+        while (!closed) {
+            deciderCondition.wait_for(lock, tick, [this] {
+                return closed;
+            });
+            if (closed)
+                break;
+            lock.unlock();
+            decidePending(false);
+            lock.lock();
+        }
+    }
+
+    int TailSamplingSender::getFailureCount() {
+        return sender.getFailureCount();
+    }
+
+    void TailSamplingSender::close() {
+        {
+            std::lock_guard<std::mutex> lock{deciderMutex};
+            if (closed)
+                return;
+            closed = true;
+        }
+        deciderCondition.notify_all();
+        if (decider.joinable()) {
+            decider.join();
+        }
+        decidePending(true);
+        sender.close();
+    }
+}